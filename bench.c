@@ -0,0 +1,151 @@
+/**
+ * \file
+ * <!--
+ * This file is part of Robin's Tunnel house window opener
+ *
+ * Bertos is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As a special exception, you may use this file as part of a free software
+ * library without restriction.  Specifically, if other files instantiate
+ * templates or use macros or inline functions from this file, or you compile
+ * this file and link it with other files to produce an executable, this
+ * file does not by itself cause the resulting executable to be covered by
+ * the GNU General Public License.  This exception does not however
+ * invalidate any other reasons why the executable file might be covered by
+ * the GNU General Public License.
+ *
+ * Copyright 2015 Robin Gilks (www.gilks.org)
+ *
+ * -->
+ *
+ * \author Robin Gilks (g8ecj@gilks.org)
+ *
+ * \brief Window opener with nrf24l01 RF remote linking
+ * Cycle counts and stack depth of the hot functions, built with BENCH defined and run under simavr
+ */
+
+
+#ifdef BENCH
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cfg/macros.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/pgmspace.h>
+
+#include <drv/ser.h>
+
+#include "minmax.h"
+#include "rtc.h"
+#include "bench.h"
+
+
+// Timer 1 counts CPU cycles from clk/1, the system tick is on timer 0 so it is free.
+// Interrupts are off while a call is timed so the count is just the call, plus the few
+// cycles of starting and stopping the timer that the "empty" line shows.
+// Below the caller's stack is painted before the call and scanned afterwards. The
+// bench_start/bench_stop frames land in there too so "empty" is the floor for the stack.
+
+extern Serial serial;
+extern uint8_t _end;
+
+#define BENCH_CANARY  0xa5
+#define BENCH_PAINT   256       // bytes of stack looked at below the caller
+
+static uint8_t *Base;           // caller's stack pointer
+static uint8_t Sreg;
+
+void
+bench_start (uint16_t sp)
+{
+   uint8_t *p, *end;
+
+   Base = (uint8_t *) sp;
+   Sreg = SREG;
+   cli ();
+
+   // paint below our own frame, the bit between it and the caller is in use
+   p = (uint8_t *) SP;
+   end = Base - BENCH_PAINT;
+   if (end < &_end)
+      end = &_end;
+   while (p >= end)
+      *p-- = BENCH_CANARY;
+
+   TCCR1A = 0;
+   TCNT1 = 0;
+   TIFR1 = BV (TOV1);
+   TCCR1B = BV (CS10);
+}
+
+void
+bench_stop (const char *name)
+{
+   uint16_t cycles;
+   uint8_t overflow;
+   uint8_t *p;
+   char buf[24];
+
+   TCCR1B = 0;
+   cycles = TCNT1;
+   overflow = (TIFR1 & BV (TOV1)) ? 1 : 0;
+
+   // the deepest byte that isn't paint any more
+   p = Base - BENCH_PAINT;
+   if (p < &_end)
+      p = &_end;
+   while (p < Base && *p == BENCH_CANARY)
+      p++;
+
+   SREG = Sreg;
+
+   strncpy_P (buf, name, sizeof (buf) - 1);
+   buf[sizeof (buf) - 1] = 0;
+   kfile_printf (&serial.fd, "BENCH,%s,%u,%u,%d\r\n", buf, cycles, (uint16_t) (Base - p), overflow);
+}
+
+
+// run instead of the main loop, one CSV line per call timed then stop the CPU
+void
+run_bench (void)
+{
+   static MINMAX mm;
+
+   kfile_printf (&serial.fd, "BENCH,function,cycles,stack,overflow\r\n");
+   BENCH_RUN ("empty", (void) 0);
+
+   minmax_init (&mm, 24, true);
+   BENCH_RUN ("minmax_add", minmax_add (&mm, 1234));
+   BENCH_RUN ("minmax_get", minmax_get (&mm));
+   BENCH_RUN ("minmax_tick", minmax_tick (&mm));
+
+   BENCH_RUN ("set_epoch_time", set_epoch_time ());
+   rtc_bench ();
+   measure_bench ();
+   window_bench ();
+   ui_bench ();
+   nrf_bench ();
+
+   // simavr stops when the CPU sleeps with interrupts off
+   kfile_flush (&serial.fd);
+   cli ();
+   sleep_enable ();
+   sleep_cpu ();
+}
+
+#endif
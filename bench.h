@@ -0,0 +1,54 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  bench.h   -   Cycle count benchmarks of the hot functions, only built with BENCH defined
+//
+//  History:   1.0 - First release. 
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#ifdef BENCH
+
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+// time one call, a line of CSV on the serial port with its name, CPU cycles and stack used
+#define BENCH_RUN(name, call)          \
+   do                                  \
+   {                                   \
+      bench_start (SP);                \
+      call;                            \
+      bench_stop (PSTR (name));        \
+   } while (0)
+
+void bench_start (uint16_t sp);
+void bench_stop (const char *name);
+void run_bench (void);
+
+// each module times its own static functions
+void rtc_bench (void);
+void measure_bench (void);
+void window_bench (void);
+void ui_bench (void);
+void nrf_bench (void);
+
+#endif
+
+#endif
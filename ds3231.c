@@ -0,0 +1,143 @@
+/**
+ * \file
+ * <!--
+ * This file is part of Robin's Tunnel house window opener
+ *
+ * Bertos is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As a special exception, you may use this file as part of a free software
+ * library without restriction.  Specifically, if other files instantiate
+ * templates or use macros or inline functions from this file, or you compile
+ * this file and link it with other files to produce an executable, this
+ * file does not by itself cause the resulting executable to be covered by
+ * the GNU General Public License.  This exception does not however
+ * invalidate any other reasons why the executable file might be covered by
+ * the GNU General Public License.
+ *
+ * Copyright 2015 Robin Gilks (www.gilks.org)
+ *
+ * -->
+ *
+ * \author Robin Gilks (g8ecj@gilks.org)
+ *
+ * \brief Window opener with nrf24l01 RF remote linking
+ * Driver for a DS3231 real time clock sharing the i2c bus with the LCD
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <cfg/macros.h>
+#include <drv/i2c.h>
+
+#include "cfg/cfg_i2c.h"
+#include "rtc.h"
+#include "ds3231.h"
+
+#define DS3231_ID        0xD0
+
+// registers
+#define DS3231_SECONDS   0x00
+#define DS3231_STATUS    0x0F
+
+// status bit saying the oscillator has stopped, so the time can't be trusted
+#define DS3231_OSF       0x80
+
+static I2c i2c;
+
+
+static uint8_t
+bcd2bin (uint8_t v)
+{
+   return (v >> 4) * 10 + (v & 0x0f);
+}
+
+static uint8_t
+bin2bcd (uint8_t v)
+{
+   return ((v / 10) << 4) | (v % 10);
+}
+
+// read a run of registers from 'reg' onwards
+static int8_t
+ds3231_readregs (uint8_t reg, uint8_t * buf, uint8_t len)
+{
+   i2c_start_w (&i2c, DS3231_ID, 1, I2C_NOSTOP);
+   i2c_putc (&i2c, reg);
+   i2c_start_r (&i2c, DS3231_ID, len, I2C_STOP);
+   i2c_read (&i2c, buf, len);
+   if (i2c_error (&i2c))
+      return -1;
+   return 0;
+}
+
+// set up the bus (the LCD does the same) and see if there is a clock on it
+int8_t
+ds3231_init (void)
+{
+   uint8_t status;
+
+   i2c_init (&i2c, I2C0, CONFIG_I2C_FREQ);
+   return ds3231_readregs (DS3231_STATUS, &status, 1);
+}
+
+// get the date and time, fails if the clock isn't there or has stopped since it was last set
+int8_t
+ds3231_get (DT_t * dt)
+{
+   uint8_t buf[7], status;
+
+   if (ds3231_readregs (DS3231_STATUS, &status, 1) || (status & DS3231_OSF))
+      return -1;
+   if (ds3231_readregs (DS3231_SECONDS, buf, sizeof (buf)))
+      return -1;
+
+   dt->S = bcd2bin (buf[0] & 0x7f);
+   dt->M = bcd2bin (buf[1] & 0x7f);
+   dt->H = bcd2bin (buf[2] & 0x3f);      // always kept in 24 hour mode
+   // buf[3] is the day of the week, not used
+   dt->d = bcd2bin (buf[4] & 0x3f);
+   dt->m = bcd2bin (buf[5] & 0x1f);
+   dt->y = bcd2bin (buf[6]);
+   return 0;
+}
+
+// set the date and time and clear the oscillator stopped flag
+int8_t
+ds3231_set (const DT_t * dt)
+{
+   uint8_t buf[8];
+
+   buf[0] = DS3231_SECONDS;
+   buf[1] = bin2bcd (dt->S);
+   buf[2] = bin2bcd (dt->M);
+   buf[3] = bin2bcd (dt->H);
+   buf[4] = 1;
+   buf[5] = bin2bcd (dt->d);
+   buf[6] = bin2bcd (dt->m);
+   buf[7] = bin2bcd (dt->y);
+   i2c_start_w (&i2c, DS3231_ID, sizeof (buf), I2C_STOP);
+   i2c_write (&i2c, buf, sizeof (buf));
+
+   buf[0] = DS3231_STATUS;
+   buf[1] = 0;
+   i2c_start_w (&i2c, DS3231_ID, 2, I2C_STOP);
+   i2c_write (&i2c, buf, 2);
+
+   if (i2c_error (&i2c))
+      return -1;
+   return 0;
+}
@@ -0,0 +1,31 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  ds3231.h   -   Optional DS3231 temperature compensated real time clock on the LCD's i2c bus
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef __DS3231_H__
+#define __DS3231_H__
+
+#include "rtc.h"
+
+// all return 0 on success, -1 if the clock isn't fitted or can't be trusted
+int8_t ds3231_init (void);
+int8_t ds3231_get (DT_t * dt);
+int8_t ds3231_set (const DT_t * dt);
+
+#endif
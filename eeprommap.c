@@ -25,16 +25,22 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 #include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <algo/crc8.h>
 
 #include "measure.h"
 #include "rtc.h"
 #include "window.h"
 #include "ui.h"
+#include "trace.h"
 
 
 // these variables are all in one place so that if another is added, we don't 
 // loose the existing value provided new stuff is *ALWAYS* added to the end
+// the settings are now kept in the config image, their old variables are only read to bring them forward
 
 
 // motor run time
@@ -43,7 +49,7 @@ int16_t EEMEM eeMotorRun;
 int16_t EEMEM eeLimits[NUMSENSORS][NUMLIMIT];
 // configured number of seconds per day to adjust clock for slow/fast 16MHz crystal
 int16_t EEMEM eeAdjustTime;
-// date and time stored when set and every hour so clock isn't too far out after a reset
+// date and time stored when set and every hour before the journal, only read now if there are no journal records
 DT_t EEMEM eeDateTime;
 // timeout for the backlight
 int16_t EEMEM eeBacklight;
@@ -53,32 +59,290 @@ int16_t EEMEM eeRadio;
 int16_t EEMEM eeBatCal;
 // stall current of the motors
 int16_t EEMEM eeStall[NUMSENSORS];
+// learned travel time of each vent
+int16_t EEMEM eeTravel[2];
+// motor activity of each vent over the previous day
+MS_t EEMEM eeYesterday[2];
+// vent control dead-band and predictive opening
+int16_t EEMEM eeDeadBand;
+int16_t EEMEM eePredict;
+// journal of the time and counters that change through the day
+JR_t EEMEM eeJournal[JOURNAL_SLOTS];
 
 
+JR_t gJournal;
+// where the next journal record goes and its sequence number
+static uint8_t JournalNext;
+static uint16_t JournalSeq;
+// the record waiting to be written by run_eeprom, the slot it goes in and how far through it we are
+static JR_t Journal;
+static uint8_t JournalSlot;
+static bool JournalPending;
+static uint8_t JournalOffset;
+
+
+// find the newest journal record with a good crc, the next one goes in the slot after it
+static void
+journal_scan (void)
+{
+   JR_t rec;
+   uint8_t slot;
+
+   gJournal.epoch = 0;
+   JournalNext = 0;
+   JournalSeq = 0;
+   for (slot = 0; slot < JOURNAL_SLOTS; slot++)
+   {
+      eeprom_read_block ((void *) &rec, (const void *) &eeJournal[slot], sizeof (rec));
+      if (rec.crc != crc8 ((uint8_t *) &rec, offsetof (JR_t, crc)) || rec.epoch == 0 || rec.epoch == 0xffffffff)
+         continue;
+      // sequence numbers wrap so compare the difference
+      if (gJournal.epoch == 0 || (int16_t) (rec.seq - JournalSeq) > 0)
+      {
+         gJournal = rec;
+         JournalSeq = rec.seq;
+         JournalNext = (slot + 1) % JOURNAL_SLOTS;
+      }
+   }
+   Journal = gJournal;
+}
+
+// queue the time and today's counters for the next journal slot, run_eeprom writes them out
+// nothing is queued if they are the same as the last record, one not yet written is brought up to date
 void
+journal_save (void)
+{
+   uint32_t now = time ();
+
+   if (Journal.epoch == now && memcmp (&Journal.today, &gToday, sizeof (Journal.today)) == 0)
+      return;
+
+   if (!JournalPending)
+   {
+      Journal.seq = ++JournalSeq;
+      JournalSlot = JournalNext;
+      JournalNext = (JournalNext + 1) % JOURNAL_SLOTS;
+   }
+   Journal.epoch = now;
+   memcpy (&Journal.today, &gToday, sizeof (Journal.today));
+   Journal.crc = crc8 ((uint8_t *) &Journal, offsetof (JR_t, crc));
+   JournalPending = true;
+   JournalOffset = 0;
+}
+
+
+// the config image, read in one go at power up and checked with a crc
+// new values are added to the end and CONFIG_VERSION bumped, older images just don't have them
+typedef struct config
+{
+   uint16_t magic;
+   uint8_t crc;                 // over the rest of the image from the version on
+   uint8_t version;             // layout it was written with
+   uint8_t size;                // of the image as written, older layouts are shorter
+   int16_t motorrun;
+   int16_t limits[NUMSENSORS][NUMLIMIT];
+   int16_t adjusttime;
+   int16_t backlight;
+   int16_t radio;
+   int16_t batcal;
+   int16_t stall[NUMSENSORS];
+   int16_t travel[2];
+   MS_t yesterday[2];
+   int16_t deadband;
+   int16_t predict;
+} CFG_t;
+
+#define CONFIG_MAGIC     0x5448 // 'TH'
+#define CONFIG_VERSION   1
+#define CONFIG_HEADER    offsetof (CFG_t, motorrun)
+
+CFG_t EEMEM eeConfig;
+
+// the config values, where they are in the image and where they were before there was one
+typedef struct eeconfig
+{
+   void *ram;
+   void *legacy;
+   uint8_t offset;
+   uint8_t size;
+} EC_t;
+
+static const EC_t eeconfig[] PROGMEM = {
+   {&gMotorRun,   &eeMotorRun,   offsetof (CFG_t, motorrun),   sizeof (gMotorRun)},
+   {&gLimits,     &eeLimits,     offsetof (CFG_t, limits),     sizeof (gLimits)},
+   {&gAdjustTime, &eeAdjustTime, offsetof (CFG_t, adjusttime), sizeof (gAdjustTime)},
+   {&gBacklight,  &eeBacklight,  offsetof (CFG_t, backlight),  sizeof (gBacklight)},
+   {&gRadio,      &eeRadio,      offsetof (CFG_t, radio),      sizeof (gRadio)},
+   {&gBatCal,     &eeBatCal,     offsetof (CFG_t, batcal),     sizeof (gBatCal)},
+   {&gStall,      &eeStall,      offsetof (CFG_t, stall),      sizeof (gStall)},
+   {&gTravel,     &eeTravel,     offsetof (CFG_t, travel),     sizeof (gTravel)},
+   {&gYesterday,  &eeYesterday,  offsetof (CFG_t, yesterday),  sizeof (gYesterday)},
+   {&gDeadBand,   &eeDeadBand,   offsetof (CFG_t, deadband),   sizeof (gDeadBand)},
+   {&gPredict,    &eePredict,    offsetof (CFG_t, predict),    sizeof (gPredict)},
+};
+
+#define NUM_CONFIG (sizeof (eeconfig) / sizeof (eeconfig[0]))
+
+// the image as it should be in eeprom
+static CFG_t Config;
+// the image has changed and how far through writing it we are
+static bool Pending;
+static uint8_t Offset;
+
+
+static uint8_t
+config_crc (void)
+{
+   return crc8 (&Config.version, sizeof (Config) - offsetof (CFG_t, version));
+}
+
+// copy a config value into the image ready to be written out
+static void
+pack (uint8_t i)
+{
+   memcpy ((uint8_t *) &Config + pgm_read_byte (&eeconfig[i].offset), (const void *) pgm_read_word (&eeconfig[i].ram),
+           pgm_read_byte (&eeconfig[i].size));
+   Config.magic = CONFIG_MAGIC;
+   Config.version = CONFIG_VERSION;
+   Config.size = sizeof (Config);
+   Config.crc = config_crc ();
+   Pending = true;
+   Offset = 0;
+}
+
+// fix up a config value, the UI knows the limits and defaults of those it can set
+// 'missing' when the image didn't have it, otherwise only put right if out of range
+static void
+check (uint8_t i, bool missing)
+{
+   int16_t *var = (int16_t *) pgm_read_word (&eeconfig[i].ram);
+   uint8_t n;
+
+   if (missing)
+      memset (var, 0, pgm_read_byte (&eeconfig[i].size));
+   for (n = 0; n < pgm_read_byte (&eeconfig[i].size) / sizeof (int16_t); n++)
+      ui_check_value (var + n, missing);
+}
+
+// read the config, returns false if the eeprom has never been set up
+// the image is read in one go, values it doesn't have (older layout) or are out of range (bad crc) get defaults
+// before there was an image the values had their own eeprom variables, those are brought forward
+bool
 load_eeprom_values (void)
 {
+   uint8_t i, offset, size;
+   bool good;
+
+   journal_scan ();
+
+   eeprom_read_block ((void *) &Config, (const void *) &eeConfig, sizeof (Config));
+   if (Config.magic == CONFIG_MAGIC && Config.size >= CONFIG_HEADER && Config.size <= sizeof (Config))
+   {
+      good = Config.crc == crc8 (&Config.version, Config.size - offsetof (CFG_t, version));
+      for (i = 0; i < NUM_CONFIG; i++)
+      {
+         offset = pgm_read_byte (&eeconfig[i].offset);
+         size = pgm_read_byte (&eeconfig[i].size);
+         if (offset + size > Config.size)
+            check (i, true);
+         else
+         {
+            memcpy ((void *) pgm_read_word (&eeconfig[i].ram), (uint8_t *) &Config + offset, size);
+            if (!good)
+               check (i, false);
+         }
+      }
+   }
+   else
+   {
+      // the layout before version 1, erased eeprom reads as -1 in the first limit
+      for (i = 0; i < NUM_CONFIG; i++)
+         eeprom_read_block ((void *) pgm_read_word (&eeconfig[i].ram), (const void *) pgm_read_word (&eeconfig[i].legacy),
+                            pgm_read_byte (&eeconfig[i].size));
+      if (gLimits[SENSOR_LOW][LIMIT_UP] == -1)
+         return false;
+      for (i = 0; i < NUM_CONFIG; i++)
+         check (i, false);
+   }
 
-   eeprom_read_block ((void *) &gLimits, (const void *) &eeLimits, sizeof (gLimits));
-   eeprom_read_block ((void *) &gAdjustTime, (const void *) &eeAdjustTime, sizeof (gAdjustTime));
-   eeprom_read_block ((void *) &gBacklight, (const void *) &eeBacklight, sizeof (gBacklight));
-   eeprom_read_block ((void *) &gRadio, (const void *) &eeRadio, sizeof (gRadio));
-   eeprom_read_block ((void *) &gBatCal, (const void *) &eeBatCal, sizeof (gBatCal));
-   eeprom_read_block ((void *) &gStall, (const void *) &eeStall, sizeof (gStall));
-   eeprom_read_block ((void *) &gMotorRun, (const void *) &eeMotorRun, sizeof (gMotorRun));
+   // bring the image up to date, only what differs gets written
+   for (i = 0; i < NUM_CONFIG; i++)
+      pack (i);
+   return true;
+}
 
+// mark the config value holding 'var' to be written to eeprom by run_eeprom
+void
+save_eeprom_value (const void *var)
+{
+   uint8_t i;
+   const uint8_t *ram;
 
+   for (i = 0; i < NUM_CONFIG; i++)
+   {
+      ram = (const uint8_t *) pgm_read_word (&eeconfig[i].ram);
+      if ((const uint8_t *) var >= ram && (const uint8_t *) var < ram + pgm_read_byte (&eeconfig[i].size))
+      {
+         pack (i);
+         return;
+      }
+   }
 }
 
+// mark all the config values to be written
 void
 save_eeprom_values (void)
 {
-   eeprom_write_block ((const void *) &gAdjustTime, (void *) &eeAdjustTime, sizeof (gAdjustTime));
-   eeprom_write_block ((const void *) &gLimits, (void *) &eeLimits, sizeof (gLimits));
-   eeprom_write_block ((const void *) &gBacklight, (void *) &eeBacklight, sizeof (gBacklight));
-   eeprom_write_block ((const void *) &gRadio, (void *) &eeRadio, sizeof (gRadio));
-   eeprom_write_block ((const void *) &gBatCal, (void *) &eeBatCal, sizeof (gBatCal));
-   eeprom_write_block ((const void *) &gStall, (void *) &eeStall, sizeof (gStall));
-   eeprom_write_block ((const void *) &gMotorRun, (void *) &eeMotorRun, sizeof (gMotorRun));
+   uint8_t i;
 
+   for (i = 0; i < NUM_CONFIG; i++)
+      pack (i);
+}
+
+// write the first byte from 'offset' on that differs from what is in eeprom
+// reading is quick so what hasn't changed is skipped, returns the offset written or -1 if there was none
+static int16_t
+write_changed (uint8_t * ee, const uint8_t * ram, uint8_t size, uint8_t * offset)
+{
+   while (*offset < size && eeprom_read_byte (ee + *offset) == ram[*offset])
+      (*offset)++;
+   if (*offset >= size)
+      return -1;
+   eeprom_write_byte (ee + *offset, ram[*offset]);
+   return (*offset)++;
+}
+
+// write out any changed config then any journal record a byte at a time, only when the last byte has finished
+// each write takes 3.3ms so this keeps the main loop going and unchanged bytes aren't touched
+// a reset part way through leaves a bad crc, the next load then checks each value or uses the previous record
+void
+run_eeprom (void)
+{
+   int16_t written;
+
+   if (!eeprom_is_ready ())
+      return;
+
+   if (Pending)
+   {
+      written = write_changed ((uint8_t *) &eeConfig, (const uint8_t *) &Config, sizeof (Config), &Offset);
+      if (written >= 0)
+         trace (TR_EEPROM, written);
+      Pending = Offset < sizeof (Config);
+   }
+   else if (JournalPending)
+   {
+      written = write_changed ((uint8_t *) &eeJournal[JournalSlot], (const uint8_t *) &Journal, sizeof (Journal),
+                               &JournalOffset);
+      if (written >= 0)
+         trace (TR_JOURNAL, (JournalSlot << 8) | written);
+      JournalPending = JournalOffset < sizeof (Journal);
+   }
+}
+
+// true while there are settings or a journal record still to be written
+bool
+eeprom_pending (void)
+{
+   return Pending || JournalPending;
 }
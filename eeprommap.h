@@ -29,14 +29,32 @@
 #include <avr/eeprom.h>
 
 #include "rtc.h"
+#include "window.h"
 
 
-// configured number of seconds per day to adjust clock for slow/fast 16MHz crystal
-extern int16_t EEMEM eeAdjustTime;
-// date and time stored when set and every hour so clock isn't too far out after a reset
+// a journal record, the time and the day's counters as they change through the day
+// written round robin over JOURNAL_SLOTS so no one cell takes every write
+typedef struct journal
+{
+   uint16_t seq;                // increments with each record, the highest is the newest
+   uint32_t epoch;              // time of the record, 0 if there isn't one
+   MS_t today[2];               // motor activity so far that day
+   uint8_t crc;
+} JR_t;
+
+#define JOURNAL_SLOTS   16
+
+// newest valid journal record found at power up
+extern JR_t gJournal;
+
+// date and time from before the journal, only used if there are no journal records
 extern DT_t EEMEM eeDateTime;
 
-void load_eeprom_values (void);
+bool load_eeprom_values (void);
 void save_eeprom_values (void);
+void save_eeprom_value (const void *var);
+void run_eeprom (void);
+bool eeprom_pending (void);
+void journal_save (void);
 
 #endif
@@ -46,12 +46,17 @@
 #include <drv/timer.h>
 #include <drv/ser.h>
 
+#include <avr/wdt.h>
+
 #include "measure.h"
 #include "rtc.h"
 #include "eeprommap.h"
 #include "window.h"
 #include "nrf.h"
 #include "ui.h"
+#include "stack.h"
+#include "watchdog.h"
+#include "bench.h"
 
 Serial serial;
 
@@ -98,6 +103,10 @@ VIN       30
 static void
 init (void)
 {
+   bool blank;
+
+   // see why we reset and start a fresh trail of breadcrumbs
+   wdog_init ();
 
    /* Initialize system timer */
    timer_init ();
@@ -108,28 +117,28 @@ init (void)
    ser_setbaudrate (&serial, 115200);
 
    // get the config stuff & last time setting
-   load_eeprom_values ();
+   blank = !load_eeprom_values ();
 
    // real time clock
    rtc_init ();
 
-   // temperature sensors
-   measure_init ();
-
-   // open/closing of windows
+   // open/closing of windows, motors stopped before anything else
    window_init ();
 
    /* Enable all the interrupts */
    IRQ_ENABLE;
 
-   // display and button handling
+   // display and button handling, up before waiting on anything slow
    ui_init ();
 
+   // temperature sensors, first conversion started but not waited for
+   measure_init ();
+
    // initialise RF link to remote
    nrf_init();
 
-   // if bad limit value assume eeprom is not initialised
-   if (gLimits[SENSOR_LOW][LIMIT_UP] == -1)
+   // nothing saved yet so start with the defaults
+   if (blank)
       ui_load_defaults();
 
 
@@ -143,57 +152,40 @@ main (void)
 
    init ();
 
+   kfile_printf (&serial.fd, "Free RAM %u\r\n", StackCount ());
+   wdog_dump (&serial.fd);
+
+#ifdef BENCH
+   // time the hot functions instead of running the controller
+   run_bench ();
+#endif
+
+   // from here on a task that hangs gets us reset, its crumb says which one it was
+   wdog_arm ();
+
    while (1)
    {
+      wdt_reset ();
       // keep real time clock stuff up to date
+      crumb (TASK_RTC);
       run_rtc ();
       // run temperature reading stuff on the 1-wire interface
+      crumb (TASK_MEASURE);
       run_measure ();
       // run state machine for window opening motors
+      crumb (TASK_WINDOWS);
       run_windows ();
       // send data back to base
+      crumb (TASK_NRF);
       key = run_nrf ();
       // display stuff on the LCD & get user input
+      crumb (TASK_UI);
       run_ui (key);
+      // write changed settings to eeprom a byte at a time
+      crumb (TASK_EEPROM);
+      run_eeprom ();
+      // keep an eye on how close the stack has come to the heap
+      crumb (TASK_STACK);
+      run_stack ();
    }
 }
-
-#if DEBUG > 0
-
-extern uint8_t _end;
-extern uint8_t __stack;
-
-#define STACK_CANARY  0xc5
-
-void StackPaint (void) __attribute__ ((naked))
-   __attribute__ ((section (".init1")));
-uint16_t StackCount (void);
-
-void
-StackPaint (void)
-{
-   uint8_t *p = &_end;
-
-   while (p <= &__stack)
-   {
-      *p = STACK_CANARY;
-      p++;
-   }
-}
-
-uint16_t
-StackCount (void)
-{
-   const uint8_t *p = &_end;
-   uint16_t c = 0;
-
-   while (*p == STACK_CANARY && p <= &__stack)
-   {
-      p++;
-      c++;
-   }
-
-   return c;
-}
-
-#endif
@@ -37,8 +37,12 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include <cfg/macros.h>
 
 #include <algo/crc8.h>
 
@@ -56,6 +60,9 @@
 #include "eeprommap.h"
 #include "measure.h"
 #include "window.h"
+#include "trace.h"
+#include "owbus.h"
+#include "bench.h"
 
 
 
@@ -69,13 +76,147 @@ int16_t gBattery;
 int16_t gBatCal;
 int16_t gCurrent[NUMSENSORS];
 int16_t gStall[NUMSENSORS];
+int16_t gEndStop[2];
+int16_t gTrend[NUMSENSORS];     // longer term trend in hundredths of a degree per hour
+int16_t gCrcRetry;              // scratchpad reads that failed the CRC and were read again
+int16_t gRejected;              // temperature readings thrown out as implausible
+
+// ROM codes of the DS2413 end stop switches on the vent buses
+static uint8_t switchid[2][OW_ROMCODE_SIZE];
+
+// each temperature sensor is alone on its bus (apart from a DS2413) so is addressed with skip ROM
+// the three buses are run together, reading the scratchpads is queued with new conversions
+// straight after it. Sensor n is on bus n (PD4 + n)
+#define SKIP_ROM        0xcc
+#define CONVERT_T       0x44
+#define READ_SCRATCHPAD 0xbe
+#define WRITE_SCRATCHPAD 0x4e
+#define ALL_BUSES       (OWB_BUS (SENSOR_LOW) | OWB_BUS (SENSOR_HIGH) | OWB_BUS (SENSOR_OUT))
+
+static OwXfer setup;
+static OwXfer convert;
+static OwXfer scratchpad;
+static uint8_t scratchrx[OWB_BUSES][OWB_MAX_RX];     // only the scratchpad read takes anything back
+static uint8_t rotate;          // which vent's end stops to read next
+static bool Ready;              // first readings are in, or we gave up waiting for them
+static ticks_t started;         // when measure_init started the first conversion
+
+// a sensor that answers but never gives a reading we accept mustn't hold up the vents for ever
+#define READY_WAIT   5000
+
+// each channel is sampled every so many 100ms passes, at the slow rate when nothing much is
+// going on and at the fast rate when it matters, as decided by fast_rate() each pass
+#define CH_BATTERY   0          // fast while a motor is loading the battery
+#define CH_SHUNT_LO  1          // fast while the lower vent motor runs
+#define CH_SHUNT_HI  2          // fast while the upper vent motor runs
+#define CH_TEMPS     3          // fast while a vent is near one of its limits
+#define CH_SWITCH    4          // fast while a vent motor runs
+#define NUMCHANNEL   5
+
+#define RATE_SLOW    0
+#define RATE_FAST    1
+
+static const uint8_t rates[NUMCHANNEL][2] PROGMEM = {
+   {50, 10},                    // battery 5s, 1s
+   {10,  1},                    // lower shunt 1s, 100ms
+   {10,  1},                    // upper shunt 1s, 100ms
+   {20,  4},                    // temperatures 2s, 400ms (11 bit conversion takes 375ms)
+   {40,  4},                    // end stops 4s, 400ms
+};
+
+// passes left before each channel is next sampled
+static uint8_t due[NUMCHANNEL];
+
+// vent temperature within this of a limit (hundredths of a degree) gets sampled fast
+#define NEAR_LIMIT   100
+
+// the trend is the gap between a fast and a slow moving average of the readings taken every
+// SLOPE_STEP seconds. On a steady rise each lags behind by (2^shift - 1) steps so the gap is the
+// rise over the difference in their lags, about 9 minutes. Averages are kept x256
+#define TREND_FAST   3          // 1/8 of each new reading, 70s behind
+#define TREND_SLOW   6          // 1/64, 630s behind
+#define TREND_LAG    (((1 << TREND_SLOW) - (1 << TREND_FAST)) * SLOPE_STEP)
+
+static int32_t trendfast[NUMSENSORS];
+static int32_t trendslow[NUMSENSORS];
+static uint8_t trendstart;      // sensors whose averages have been started, a bit each
+
+// each reading goes through a plausibility check then a median of the last few accepted,
+// only what comes out of the median goes to gValues and from there to control and history
+#define MEDIAN_N     3
+#define MAX_STEP     200        // most a reading may move from the last accepted (2 degrees)
+#define REJECT_RUN   5          // this many out of step in a row is taken as a real change
+#define POWER_ON     8500       // what a DS18B20 reads before its first conversion
+#define CRC_RETRIES  2          // reads of a scratchpad that fails its CRC
+
+typedef struct Median_t
+{
+   int16_t window[MEDIAN_N];    // last accepted readings
+   uint8_t fill;                // how many of them there are
+   uint8_t next;                // where the next one goes
+   uint8_t runs;                // readings rejected in a row
+   int16_t last;                // last value out of the median
+} Median_t;
+
+static Median_t median[NUMSENSORS];
+static uint8_t retries;         // CRC retries of the current conversion
+
+#ifndef DS2413_FAMILY_CODE
+#define DS2413_FAMILY_CODE 0x3A
+#endif
+// PIO pin state bits as returned by ow_ds2413_read
+#define DS2413_PIOA  0x01       // open limit switch
+#define DS2413_PIOB  0x04       // closed limit switch
+
+// motor charge used (mA x 100mS) not yet counted as a whole amp-second
+static uint16_t charge[2];
 
 uint8_t gpioid = 0;
 uint8_t gthermid = 0;
 uint32_t lasthour;
+uint32_t lastslope;
 ticks_t lasttime;
 
 
+// look for a DS2413 on the current bus to read the vent end stop switches
+static void
+find_switch (uint8_t sensor)
+{
+   uint8_t diff = OW_SEARCH_FIRST;
+
+   gEndStop[sensor] = ENDSTOP_NONE;
+   while (diff != OW_LAST_DEVICE)
+   {
+      diff = ow_rom_search (diff, switchid[sensor]);
+      if ((diff == OW_PRESENCE_ERR) || (diff == OW_DATA_ERR))
+         break;
+      if (switchid[sensor][0] == DS2413_FAMILY_CODE)
+      {
+         gEndStop[sensor] = 0;
+         break;
+      }
+   }
+}
+
+// read the end stop switches of a vent
+// the switches pull the PIO pins low when made.
+// The DS2413 shares the bus with the temperature sensor so is read while a conversion is in progress,
+// sensors on a bus with a DS2413 must be externally powered.
+static void
+read_switch (uint8_t sensor)
+{
+   int16_t pio;
+
+   if (gEndStop[sensor] == ENDSTOP_NONE)
+      return;
+   if (ow_set_bus (&PIND, &PORTD, &DDRD, sensor == SENSOR_LOW ? PD4 : PD5))
+      return;
+   pio = ow_ds2413_read (switchid[sensor]);
+   if (pio < 0)
+      return;
+   gEndStop[sensor] = ((pio & DS2413_PIOA) ? 0 : ENDSTOP_OPEN) | ((pio & DS2413_PIOB) ? 0 : ENDSTOP_CLOSED);
+}
+
 // do a bit of init for testing
 void
 measure_init (void)
@@ -83,7 +224,9 @@ measure_init (void)
    uint8_t i, j;
 
    lasthour = uptime ();
+   lastslope = uptime ();
    lasttime = timer_clock ();
+   started = lasttime;
    // initialise all the min/max buffers (hourly and daily)
    for (i = 0; i < NUMSENSORS; i++)
    {
@@ -93,45 +236,58 @@ measure_init (void)
          gValues[i][j] = 0;
    }
 
-   // start off temperature conversion on all sensors
+   convert.buses = ALL_BUSES;
+   convert.ntx = 2;
+   convert.tx[0] = SKIP_ROM;
+   convert.tx[1] = CONVERT_T;
+   convert.status = OWB_IDLE;
+   scratchpad.buses = ALL_BUSES;
+   scratchpad.ntx = 2;
+   scratchpad.nrx = 9;
+   scratchpad.crc = true;
+   scratchpad.rx = scratchrx;
+   scratchpad.tx[0] = SKIP_ROM;
+   scratchpad.tx[1] = READ_SCRATCHPAD;
+   scratchpad.status = OWB_IDLE;
+   owb_init ();
+
+   // look for the end stop switches, a quick search of each vent bus
+   gEndStop[SENSOR_LOW] = ENDSTOP_NONE;
    if (ow_set_bus (&PIND, &PORTD, &DDRD, PD4) == 0)          // SENSOR_LOW
-   {
-      ow_ds18x20_resolution(NULL, 11);
-      ow_ds18X20_start (NULL, false);
-      while (ow_busy());
-      ow_ds18X20_start (NULL, false);
-   }
-   else
-   {
-      minmax_add (&daymin[SENSOR_LOW], 0);      // clear min/max if no sensor
-      minmax_add (&daymax[SENSOR_LOW], 0);
-   }
-
+      find_switch (SENSOR_LOW);
+   gEndStop[SENSOR_HIGH] = ENDSTOP_NONE;
    if (ow_set_bus (&PIND, &PORTD, &DDRD, PD5) == 0)          // SENSOR_HIGH
-   {
-      ow_ds18x20_resolution(NULL, 11);
-      ow_ds18X20_start (NULL, false);
-      while (ow_busy());
-      ow_ds18X20_start (NULL, false);
-   }
-   else
-   {
-      minmax_add (&daymin[SENSOR_HIGH], 0);
-      minmax_add (&daymax[SENSOR_HIGH], 0);
-   }
+      find_switch (SENSOR_HIGH);
+
+   // set 11 bit resolution and start the first conversions on all the buses. Nothing waits for
+   // them, run_measure reads them 400ms from now and the vents are left alone until it has.
+   setup.buses = ALL_BUSES;
+   setup.ntx = 5;
+   setup.tx[0] = SKIP_ROM;
+   setup.tx[1] = WRITE_SCRATCHPAD;
+   setup.tx[2] = 0x4b;          // alarm high and low, the power up values
+   setup.tx[3] = 0x46;
+   setup.tx[4] = 0x5f;          // 11 bits
+   owb_queue (&setup);
+   owb_queue (&convert);
+   // first read once the conversion is done, everything else straight away
+   memset (due, 0, sizeof (due));
+   due[CH_TEMPS] = pgm_read_byte (&rates[CH_TEMPS][RATE_FAST]);
+}
 
-   if (ow_set_bus (&PIND, &PORTD, &DDRD, PD6) == 0)          // SENSOR_OUT
-   {
-      ow_ds18x20_resolution(NULL, 11);
-      ow_ds18X20_start (NULL, false);
-      while (ow_busy());
-      ow_ds18X20_start (NULL, false);
-   }
-   else
-   {
-      minmax_add (&daymin[SENSOR_OUT], 0);
-      minmax_add (&daymax[SENSOR_OUT], 0);
-   }
+// true once the first temperatures have been read from every sensor that answers, or once
+// READY_WAIT has gone by without them
+bool
+measure_ready (void)
+{
+   return Ready;
+}
+
+// true if a sensor has given a reading we accepted, so its value is worth acting on
+bool
+measure_valid (uint8_t sensor)
+{
+   return median[sensor].fill != 0;
 }
 
 
@@ -164,27 +320,238 @@ validate_value(int16_t value)
    return value;
 }
 
+// a DS18B20 scratchpad temperature (1/16 degree) in hundredths of a degree
+static int16_t
+scratchpad_temperature (const uint8_t * rx)
+{
+   int16_t raw = rx[0] | (rx[1] << 8);
+
+   return (int32_t) raw * 100 / 16;
+}
+
+// start a sensor's median window off full of one reading
+static void
+median_seed (Median_t * m, int16_t t)
+{
+   uint8_t i;
+
+   for (i = 0; i < MEDIAN_N; i++)
+      m->window[i] = t;
+   m->fill = MEDIAN_N;
+   m->next = 0;
+   m->runs = 0;
+   m->last = t;
+}
+
+// median of what is in the window, a small insertion sort of a copy
+static int16_t
+median_get (const Median_t * m)
+{
+   int16_t sorted[MEDIAN_N], t;
+   uint8_t i, j;
+
+   for (i = 0; i < m->fill; i++)
+   {
+      t = m->window[i];
+      for (j = i; j > 0 && sorted[j - 1] > t; j--)
+         sorted[j] = sorted[j - 1];
+      sorted[j] = t;
+   }
+   return sorted[m->fill / 2];
+}
+
+// put a new reading from a sensor through the checks, false if it is to be thrown away
+// otherwise *value is the median of it and the last few accepted
+static bool
+condition (uint8_t sensor, int16_t t, int16_t * value)
+{
+   Median_t *m = &median[sensor];
+
+   // the power on value is only believable if it is where we already were
+   if (t == POWER_ON && (m->fill == 0 || abs (m->last - t) > MAX_STEP))
+      return false;
+
+   t = validate_value (t);
+   if (m->fill == 0)
+      median_seed (m, t);
+   else if (abs (t - m->last) > MAX_STEP)
+   {
+      // a single glitch is dropped, a step that stays is a real change (a sensor moved or refitted)
+      if (++m->runs < REJECT_RUN)
+         return false;
+      median_seed (m, t);
+   }
+   else
+   {
+      m->runs = 0;
+      m->window[m->next] = t;
+      m->next = (m->next + 1) % MEDIAN_N;
+      if (m->fill < MEDIAN_N)
+         m->fill++;
+   }
+   m->last = median_get (m);
+   *value = m->last;
+   return true;
+}
+
+// add a 100mS current sample into the charge used by a running motor
+static void
+add_charge (uint8_t sensor, uint16_t current)
+{
+   if (!windowmoving (sensor))
+      return;
+   charge[sensor] += current;
+   while (charge[sensor] >= 10000)
+   {
+      charge[sensor] -= 10000;
+      gToday[sensor].ampsecs++;
+   }
+}
+
+// move the trend averages on by one step, a fixed amount of work whatever the history
+static void
+update_trend (void)
+{
+   uint8_t i;
+   int32_t t, rate;
+
+   for (i = 0; i < NUMSENSORS; i++)
+   {
+      // nothing accepted from this sensor yet
+      if (median[i].fill == 0)
+         continue;
+      t = (int32_t) gValues[i][TINDEX_NOW] << 8;
+      // start both averages at the first reading so it doesn't look like a rise from zero
+      if (!(trendstart & BV (i)))
+      {
+         trendstart |= BV (i);
+         trendfast[i] = t;
+         trendslow[i] = t;
+      }
+      trendfast[i] += (t - trendfast[i]) >> TREND_FAST;
+      trendslow[i] += (t - trendslow[i]) >> TREND_SLOW;
+      // per hour, taken down to x16 first to keep clear of overflow
+      rate = ((trendfast[i] - trendslow[i]) >> 4) * 3600 / ((int32_t) TREND_LAG << 4);
+      if (rate > 9990)
+         rate = 9990;
+      else if (rate < -9990)
+         rate = -9990;
+      gTrend[i] = rate;
+   }
+}
+
 #define ALPHA 0.05
-// poll round our sensors in turn, if conversion finished then note the value and start a new conversion
+
+// battery volts (10mV units) from the ADC reading, trimmed by the calibration
+static int16_t
+scale_battery (uint16_t raw)
+{
+   return (uint32_t) raw * V_SCALE * (10000 + gBatCal) / 100000;
+}
+
+// motor current from a shunt reading, lightly smoothed
+static int16_t
+filter_current (int16_t current, uint16_t volts)
+{
+   return (int16_t) ((ALPHA * (float) volts) + (1 - ALPHA) * (float) current);
+}
+
+// is either vent temperature close enough to a limit that the vent may be about to move
+static bool
+near_limit (void)
+{
+   int16_t now, up, down;
+   uint8_t i;
+
+   for (i = SENSOR_LOW; i <= SENSOR_HIGH; i++)
+   {
+      getlims (i, &now, &up, &down);
+      if (abs (now - up) < NEAR_LIMIT || abs (now - down) < NEAR_LIMIT)
+         return true;
+   }
+   return false;
+}
+
+// pick the rate for a channel from what the vents are doing
+static bool
+fast_rate (uint8_t channel)
+{
+   switch (channel)
+   {
+   case CH_SHUNT_LO:
+      return windowmoving (SENSOR_LOW);
+   case CH_SHUNT_HI:
+      return windowmoving (SENSOR_HIGH);
+   case CH_TEMPS:
+      return !Ready || near_limit ();
+   default:
+      return windowmoving (SENSOR_LOW) || windowmoving (SENSOR_HIGH);
+   }
+}
+
+// passes between samples of a channel at the rate it should be going now
+static uint8_t
+channel_period (uint8_t channel)
+{
+   return pgm_read_byte (&rates[channel][fast_rate (channel) ? RATE_FAST : RATE_SLOW]);
+}
+
+// count down to a channel's next sample, a rate that has just gone up takes effect at once
+static bool
+channel_due (uint8_t channel)
+{
+   uint8_t period;
+
+   period = channel_period (channel);
+   if (due[channel] > period)
+      due[channel] = period;
+   if (due[channel] > 1)
+   {
+      due[channel]--;
+      return false;
+   }
+   due[channel] = period;
+   return true;
+}
+
+// sample a motor shunt. The reading is smoothed while the motor runs and taken as it is
+// when stopped, so the current drops straight back rather than decaying at the slow rate
+static void
+sample_shunt (uint8_t sensor, uint16_t volts)
+{
+   add_charge (sensor, volts);
+   if (windowmoving (sensor))
+      gCurrent[sensor] = filter_current (gCurrent[sensor], volts);
+   else
+      gCurrent[sensor] = volts;
+}
+
+// poll round our sensors, each channel at its own rate. If a conversion finished then note the
+// value and start a new conversion
 void
 run_measure (void)
 {
-   static char rotate = 0;
    int16_t t;
    int8_t i;
-   uint16_t volts;
+   uint8_t failed;
 
    if (timer_clock () - lasttime < ms_to_ticks (100))
       return;
 
    lasttime = timer_clock ();
 
-   gBattery = (uint32_t) analog_read (6) * V_SCALE * (10000 + gBatCal) / 100000;
-   volts = analog_read (3) / RSHUNTDN;
-   gCurrent[SENSOR_LOW] = (int16_t) ((ALPHA * (float) volts) + (1 - ALPHA) * (float) gCurrent[SENSOR_LOW]);
+   if (!Ready && timer_clock () - started > ms_to_ticks (READY_WAIT))
+      Ready = true;
 
-   volts = analog_read (7) / RSHUNTUP;
-   gCurrent[SENSOR_HIGH] = (int16_t) ((ALPHA * (float) volts) + (1 - ALPHA) * (float) gCurrent[SENSOR_HIGH]);
+   if (channel_due (CH_BATTERY))
+   {
+      gBattery = scale_battery (analog_read (6));
+      trace (TR_ADC, gBattery);
+   }
+   if (channel_due (CH_SHUNT_LO))
+      sample_shunt (SENSOR_LOW, analog_read (3) / RSHUNTDN);
+   if (channel_due (CH_SHUNT_HI))
+      sample_shunt (SENSOR_HIGH, analog_read (7) / RSHUNTUP);
 
 #if 0
 extern Serial serial;
@@ -192,59 +559,92 @@ extern Serial serial;
       kfile_printf(&serial.fd, "I up %d\n", gCurrent[SENSOR_HIGH]);
 #endif
 
-   // do one sensor each time round
-   switch (rotate & 3)
+   if (channel_due (CH_SWITCH))
    {
-   case SENSOR_LOW:
-      // low level sensor
-      if (ow_set_bus (&PIND, &PORTD, &DDRD, PD4))          // SENSOR_LOW
-         break;
-      if (!ow_busy ())
+      // vent end stop switches, favour a vent whose motor is running otherwise take each in turn
+      if (windowmoving (SENSOR_LOW) && !windowmoving (SENSOR_HIGH))
+         i = SENSOR_LOW;
+      else if (windowmoving (SENSOR_HIGH) && !windowmoving (SENSOR_LOW))
+         i = SENSOR_HIGH;
+      else
+         i = rotate++ & 1;
+      // the DS2413 is read with the 1-wire driver, keep off the bus while a transfer is running
+      if (!owb_busy ())
+         read_switch (i);
+   }
+
+   // all the temperature sensors at once, held off while still on the bus from last time.
+   // A CRC retry goes straight away rather than waiting for the next due reading
+   if (scratchpad.status != OWB_BUSY && convert.status != OWB_BUSY && (retries || channel_due (CH_TEMPS)))
+   {
+      failed = 0;
+      for (i = 0; i < NUMSENSORS; i++)
       {
-         if (ow_ds18X20_read_temperature (NULL, &t))
+         if (scratchpad.status != OWB_OK || !(scratchpad.buses & OWB_BUS (i)))
+            continue;
+         if (!owb_present (&scratchpad, i))
          {
-            t = validate_value(t);
-            gValues[SENSOR_LOW][TINDEX_NOW] = t;
-            minmax_add (&daymin[SENSOR_LOW], t);
-            minmax_add (&daymax[SENSOR_LOW], t);
+            // clear min/max if no sensor
+            if (!Ready)
+            {
+               minmax_add (&daymin[i], 0);
+               minmax_add (&daymax[i], 0);
+            }
+            continue;
          }
-         ow_ds18X20_start (NULL, false);
-     }
-      break;
-   case SENSOR_HIGH:
-      // high level (roof) sensor
-      if (ow_set_bus (&PIND, &PORTD, &DDRD, PD5))         // SENSOR_HIGH
-         break;
-      if (!ow_busy ())
-      {
-         if (ow_ds18X20_read_temperature (NULL, &t))
+         if (!owb_good (&scratchpad, i))
+         {
+            failed |= OWB_BUS (i);
+            continue;
+         }
+         t = scratchpad_temperature (scratchpad.rx[i]);
+         if (!condition (i, t, &t))
          {
-            t = validate_value(t);
-            gValues[SENSOR_HIGH][TINDEX_NOW] = t;
-            minmax_add (&daymin[SENSOR_HIGH], t);
-            minmax_add (&daymax[SENSOR_HIGH], t);
+            gRejected++;
+            trace (TR_OW_REJECT, t);
+            continue;
          }
-         ow_ds18X20_start (NULL, false);
+         trace (TR_OW_READ, t);
+         gValues[i][TINDEX_NOW] = t;
+         minmax_add (&daymin[i], t);
+         minmax_add (&daymax[i], t);
       }
-      break;
-   case SENSOR_OUT:
-      // outside sensor
-      if (ow_set_bus (&PIND, &PORTD, &DDRD, PD6))          // SENSOR_OUT
-         break;
-      if (!ow_busy ())
+
+      // the conversion result stays in the scratchpad so read again just the ones that failed
+      if (failed && retries < CRC_RETRIES)
       {
-         if (ow_ds18X20_read_temperature (NULL, &t))
+         retries++;
+         gCrcRetry++;
+         scratchpad.buses = failed;
+         owb_queue (&scratchpad);
+      }
+      else
+      {
+         // ready once every sensor that answered a full read has something accepted
+         if (scratchpad.status == OWB_OK && scratchpad.buses == ALL_BUSES && !Ready)
          {
-            t = validate_value(t);
-            gValues[SENSOR_OUT][TINDEX_NOW] = t;
-            minmax_add (&daymin[SENSOR_OUT], t);
-            minmax_add (&daymax[SENSOR_OUT], t);
+            Ready = true;
+            for (i = 0; i < NUMSENSORS; i++)
+               if (owb_present (&scratchpad, i) && median[i].fill == 0)
+                  Ready = false;
          }
-         ow_ds18X20_start (NULL, false);
+         // read what the conversions started last time came to and start more
+         retries = 0;
+         scratchpad.buses = ALL_BUSES;
+         owb_queue (&scratchpad);
+         owb_queue (&convert);
+         trace (TR_OW_START, scratchpad.buses);
+         // a retry gets here without waiting its turn, so count the whole period from this new
+         // conversion or the next read comes before it is done and gets the last one again
+         due[CH_TEMPS] = channel_period (CH_TEMPS);
       }
-      break;
    }
-   rotate++;
+
+   if (uptime () >= lastslope + SLOPE_STEP)
+   {
+      lastslope = uptime ();
+      update_trend ();
+   }
 
    // see if we have finished an hour, if so then move to a new hour
    if (uptime () >= lasthour + 3600)
@@ -266,3 +666,19 @@ extern Serial serial;
    }
 
 }
+
+
+#ifdef BENCH
+// the ADC read and the floating point scaling done on every 100ms pass, and the 10s trend update
+void
+measure_bench (void)
+{
+   uint16_t raw = 0, volts = 0;
+
+   BENCH_RUN ("analog_read", raw = analog_read (6));
+   BENCH_RUN ("scale_battery", gBattery = scale_battery (raw));
+   BENCH_RUN ("shunt scaling", volts = analog_read (3) / RSHUNTDN);
+   BENCH_RUN ("filter_current", gCurrent[SENSOR_LOW] = filter_current (gCurrent[SENSOR_LOW], volts));
+   BENCH_RUN ("update_trend", update_trend ());
+}
+#endif
@@ -1,3 +1,6 @@
+#include <stdint.h>
+#include <stdbool.h>
+
 
 
 
@@ -19,6 +22,14 @@
 #define LIMIT_UP    0
 #define LIMIT_DN    1
 
+// end stop switch state of a vent, read from a DS2413 on the vent's sensor bus
+#define ENDSTOP_NONE   -1       // no DS2413 found
+#define ENDSTOP_OPEN    1       // fully open switch made
+#define ENDSTOP_CLOSED  2       // fully closed switch made
+
+// temperature trend is moved on from readings this many seconds apart
+#define SLOPE_STEP     10
+
 // current shunt resistor value
 #define RSHUNTUP       0.095
 #define RSHUNTDN       0.085
@@ -31,11 +42,17 @@ extern int16_t gBattery;
 extern int16_t gBatCal;
 extern int16_t gCurrent[NUMSENSORS];
 extern int16_t gStall[NUMSENSORS];
+extern int16_t gEndStop[2];
+extern int16_t gTrend[NUMSENSORS];
+extern int16_t gCrcRetry;
+extern int16_t gRejected;
 
 
 
 void measure_init (void);
 int8_t getlims (uint8_t sensor, int16_t * now, int16_t * up, int16_t * down);
 void run_measure (void);
+bool measure_ready (void);
+bool measure_valid (uint8_t sensor);
 
 
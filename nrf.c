@@ -39,6 +39,8 @@
  * track battery voltage and a serial interface for debugging.
  */
 
+#include <cfg/compiler.h>
+
 #include <drv/ser.h>
 #include <drv/timer.h>
 #include <net/nrf24l01.h>
@@ -47,11 +49,25 @@
 #include "rtc.h"
 #include "ui.h"
 #include "nrf.h"
+#include "stack.h"
+#include "watchdog.h"
+#include "trace.h"
+#include "bench.h"
 
 
 extern Serial serial;
 
 #define KEYSTROKE 'K'
+#define TIMESYNC 'T'
+
+// every packet has to fit the radio payload, the 'S' packet is the date then the temperatures
+// and the 'V' packet the vent states then the end stop switches
+#define S_VALUES    7
+#define V_ENDSTOPS  (1 + sizeof (gWinState))
+STATIC_ASSERT (S_VALUES + sizeof (gValues) <= NRF24L01_PAYLOAD);
+STATIC_ASSERT (V_ENDSTOPS + 1 <= NRF24L01_PAYLOAD);
+STATIC_ASSERT (1 + sizeof (gToday) <= NRF24L01_PAYLOAD);
+STATIC_ASSERT (1 + sizeof (gTrend) <= NRF24L01_PAYLOAD);
 
 uint8_t addrtx0[NRF24L01_ADDRSIZE] = NRF24L01_ADDRP0;
 uint8_t addrtx1[NRF24L01_ADDRSIZE] = NRF24L01_ADDRP1;
@@ -80,6 +96,22 @@ nrf_init(void)
 }
 
 
+// the 'S' packet, date, time and temperatures
+static void
+build_stats (uint8_t * buffer)
+{
+   update_datetime ();
+   buffer[0] = 'S';
+   buffer[1] = gSECOND;
+   buffer[2] = gMINUTE;
+   buffer[3] = gHOUR;
+   buffer[4] = gDAY;
+   buffer[5] = gMONTH;
+   buffer[6] = gYEAR;
+   memcpy(&buffer[S_VALUES], &gValues, sizeof(gValues));
+}
+
+
 uint8_t
 run_nrf (void)
 {
@@ -95,9 +127,19 @@ run_nrf (void)
    {
       //read buffer
       nrf24l01_read (buffer);
+      trace (TR_NRF_RX, buffer[0]);
       // see if a keyboard command. If so return the keycode
       if (buffer[0] == KEYSTROKE)
          ret = buffer[1];
+      // time stamp from the remote, Unix time and how many ms old it was when sent
+      else if (buffer[0] == TIMESYNC)
+      {
+         uint32_t remote;
+         uint16_t age;
+         memcpy(&remote, &buffer[1], sizeof(remote));
+         memcpy(&age, &buffer[5], sizeof(age));
+         rtc_sync (remote, age);
+      }
    }
 
    // throttle data transfer by only doing every 'n' ms, controlled by the UI
@@ -147,20 +189,53 @@ run_nrf (void)
    {
       statistics_timer = timer_clock ();
       nrf24l01_settxaddr (addrtx1);
-      buffer[0] = 'S';
-      buffer[1] = gSECOND;
-      buffer[2] = gMINUTE;
-      buffer[3] = gHOUR;
-      buffer[4] = gDAY;
-      buffer[5] = gMONTH;
-      buffer[6] = gYEAR;
-      memcpy(&buffer[7], &gValues, sizeof(gValues));
-      memcpy(&buffer[7 + sizeof(gValues)], &gWinState, sizeof(gWinState));
+      build_stats (buffer);
+      status &= nrf24l01_write(buffer);
+
+      // vent states and the end stop switches, a nibble per vent (0xf if none fitted)
+      buffer[0] = 'V';
+      memcpy(&buffer[1], &gWinState, sizeof(gWinState));
+      buffer[V_ENDSTOPS] = (gEndStop[SENSOR_LOW] & 0x0f) | (gEndStop[SENSOR_HIGH] << 4);
+      status &= nrf24l01_write(buffer);
+
+      // temperature trend of each sensor (hundredths of a degree an hour)
+      buffer[0] = 'G';
+      memcpy(&buffer[1], &gTrend, sizeof(gTrend));
+      status &= nrf24l01_write(buffer);
+
+      // motor activity of both vents today and yesterday
+      buffer[0] = 'M';
+      memcpy(&buffer[1], &gToday, sizeof(gToday));
+      status &= nrf24l01_write(buffer);
+      buffer[0] = 'Y';
+      memcpy(&buffer[1], &gYesterday, sizeof(gYesterday));
+      status &= nrf24l01_write(buffer);
+
+      // memory diagnostics, stack high water, heap and least free RAM (bytes)
+      buffer[0] = 'D';
+      memcpy(&buffer[1], &gStackUsed, sizeof(gStackUsed));
+      memcpy(&buffer[3], &gHeapUsed, sizeof(gHeapUsed));
+      memcpy(&buffer[5], &gMinFree, sizeof(gMinFree));
+      // and how long boot took to the first screen and to the vents being controlled (ms)
+      memcpy(&buffer[7], &gBootScreen, sizeof(gBootScreen));
+      memcpy(&buffer[9], &gBootControl, sizeof(gBootControl));
+      // and how the temperature sensors are behaving
+      memcpy(&buffer[11], &gCrcRetry, sizeof(gCrcRetry));
+      memcpy(&buffer[13], &gRejected, sizeof(gRejected));
+      // and how far out the clock was at the last time sync (ms)
+      memcpy(&buffer[15], &gSyncOffset, sizeof(gSyncOffset));
+      status &= nrf24l01_write(buffer);
+
+      // why we last reset and, if it was the watchdog, the breadcrumbs leading up to it
+      buffer[0] = 'R';
+      wdog_report (&buffer[1], sizeof (buffer) - 1);
       status &= nrf24l01_write(buffer);
    }
 
 
 
+   trace (TR_NRF_TX, status);
+
    // debug report via serial interface
    if (status != 1)
    {
@@ -174,3 +249,13 @@ run_nrf (void)
    return ret;
 }
 
+
+#ifdef BENCH
+void
+nrf_bench (void)
+{
+   uint8_t buffer[NRF24L01_PAYLOAD];
+
+   BENCH_RUN ("build_stats", build_stats (buffer));
+}
+#endif
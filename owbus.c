@@ -0,0 +1,274 @@
+/**
+ * \file
+ * <!--
+ * This file is part of Robin's Tunnel house window opener
+ *
+ * Bertos is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As a special exception, you may use this file as part of a free software
+ * library without restriction.  Specifically, if other files instantiate
+ * templates or use macros or inline functions from this file, or you compile
+ * this file and link it with other files to produce an executable, this
+ * file does not by itself cause the resulting executable to be covered by
+ * the GNU General Public License.  This exception does not however
+ * invalidate any other reasons why the executable file might be covered by
+ * the GNU General Public License.
+ *
+ * Copyright 2015 Robin Gilks (www.gilks.org)
+ *
+ * -->
+ *
+ * \author Robin Gilks (g8ecj@gilks.org)
+ *
+ * \brief Window opener with nrf24l01 RF remote linking
+ * Interrupt driven 1-wire transfers on timer 2 so the main loop never waits on the bus
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <cfg/compiler.h>
+#include <cfg/macros.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#define F_CPU CPU_FREQ
+#include <util/delay.h>
+#include <util/crc16.h>
+
+#include "owbus.h"
+
+
+// A transfer is a reset, some bytes written and some read, run a phase per timer 2
+// compare interrupt. Between phases the bus is idle or held low by the port and nothing
+// waits. The only busy waits are the 15us at the start of a write 1 or read slot, done in
+// the interrupt so nothing else can stretch them. Timings are the Maxim recommended ones.
+// Buses are on PORTD. A bus is driven low by making its pin an output (the PORTD bit is
+// kept 0) and let go by making it an input again.
+// All the buses of a transfer run in step, one DDRD write drives every one of them and
+// one PIND read samples them all, so three sensors take no longer than one.
+
+#define US(us)      ((us) / 2)  // timer 2 at clk/32 counts in 2us
+
+enum PHASE
+{
+   PH_RESET,                    // pull low for the reset pulse
+   PH_RELEASE,                  // let go and wait for the presence pulse
+   PH_PRESENCE,                 // see what answered
+   PH_BITS,                     // next bit slot
+   PH_LOW0                      // end of a write 0 slot
+};
+
+// the queue is moved on by the interrupt and looked at from the main line
+static OwXfer *Queue[OWB_QUEUE];
+static volatile uint8_t QHead, QCount;
+static OwXfer *volatile Cur;    // transfer on the bus, Queue[QHead]
+static uint8_t Mask;            // its buses that answered
+static uint8_t Ones;            // buses that have read a 1, one held low reads all 0 with a good CRC
+static uint8_t Phase, Byte, Bit;
+static uint8_t Crc[OWB_BUSES];
+
+
+void
+owb_init (void)
+{
+   TCCR2A = 0;
+   TCCR2B = BV (CS21) | BV (CS20);      // clk/32
+   TIMSK2 &= ~BV (OCIE2A);
+}
+
+// next phase this many ticks after the last one started
+INLINE void
+schedule (uint8_t ticks)
+{
+   OCR2A += ticks;
+}
+
+// get the transfer at the head of the queue going
+static void
+start (uint8_t ticks)
+{
+   uint8_t n;
+
+   Cur = Queue[QHead];
+   Mask = Cur->buses;
+   PORTD &= ~Mask;
+   Phase = PH_RESET;
+   Byte = 0;
+   Bit = 0;
+   Ones = 0;
+   for (n = 0; n < OWB_BUSES; n++)
+      Crc[n] = 0;
+   OCR2A = TCNT2 + ticks;
+   TIFR2 = BV (OCF2A);
+   TIMSK2 |= BV (OCIE2A);
+}
+
+static void
+finish (void)
+{
+   OwXfer *x = Cur;
+   uint8_t n;
+
+   DDRD &= ~Mask;
+   // the CRC of data with its CRC byte on the end comes out as 0, so does all 0 from a bus held low
+   if (x->crc)
+   {
+      for (n = 0; n < OWB_BUSES; n++)
+         if (Crc[n])
+            Mask &= ~OWB_BUS (n);
+      Mask &= Ones;
+   }
+   x->good = Mask;
+
+   QHead = (QHead + 1) % OWB_QUEUE;
+   QCount--;
+   if (QCount)
+      start (US (20));
+   else
+   {
+      TIMSK2 &= ~BV (OCIE2A);
+      Cur = NULL;
+   }
+
+   x->status = OWB_OK;
+   if (x->done)
+      x->done (x);
+}
+
+// one bit slot. A 1 (and a read) is a short low pulse, a read samples the buses 15us in.
+// A 0 holds the buses low for most of the slot and lets go in the PH_LOW0 phase.
+static void
+bit_slot (void)
+{
+   uint8_t n, pins, *b;
+
+   if (Byte >= Cur->ntx + Cur->nrx)
+   {
+      finish ();
+      return;
+   }
+
+   if (Byte < Cur->ntx)
+   {
+      if (Cur->tx[Byte] & BV (Bit))
+      {
+         DDRD |= Mask;
+         _delay_us (6);
+         DDRD &= ~Mask;
+         schedule (US (70));
+      }
+      else
+      {
+         DDRD |= Mask;
+         schedule (US (60));
+         Phase = PH_LOW0;
+      }
+   }
+   else
+   {
+      DDRD |= Mask;
+      _delay_us (6);
+      DDRD &= ~Mask;
+      _delay_us (9);
+      pins = PIND;
+      Ones |= pins;
+      // the time critical part is over, share the sample out among the buses
+      for (n = 0; n < OWB_BUSES; n++)
+      {
+         b = &Cur->rx[n][Byte - Cur->ntx];
+         if (Bit == 0)
+            *b = 0;
+         if (pins & OWB_BUS (n))
+            *b |= BV (Bit);
+         if (Bit == 7)
+            Crc[n] = _crc_ibutton_update (Crc[n], *b);
+      }
+      schedule (US (55));
+   }
+
+   if (++Bit == 8)
+   {
+      Bit = 0;
+      Byte++;
+   }
+}
+
+ISR (TIMER2_COMPA_vect)
+{
+   switch (Phase)
+   {
+   case PH_RESET:
+      DDRD |= Mask;
+      schedule (US (480));
+      Phase = PH_RELEASE;
+      break;
+   case PH_RELEASE:
+      DDRD &= ~Mask;
+      schedule (US (70));
+      Phase = PH_PRESENCE;
+      break;
+   case PH_PRESENCE:
+      // a device pulls its bus low, carry on with those that did
+      Mask &= ~PIND;
+      Cur->present = Mask;
+      if (!Mask)
+      {
+         finish ();
+         break;
+      }
+      schedule (US (410));
+      Phase = PH_BITS;
+      break;
+   case PH_BITS:
+      bit_slot ();
+      break;
+   case PH_LOW0:
+      DDRD &= ~Mask;
+      schedule (US (10));
+      Phase = PH_BITS;
+      break;
+   }
+}
+
+
+// add a transfer to the queue, false if the queue is full
+// its status is OWB_BUSY until it has been done, then its done function (if any) is called
+// from the interrupt
+bool
+owb_queue (OwXfer * x)
+{
+   ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+   {
+      if (QCount >= OWB_QUEUE)
+         return false;
+      x->status = OWB_BUSY;
+      Queue[(QHead + QCount) % OWB_QUEUE] = x;
+      QCount++;
+      if (!Cur)
+         start (US (20));
+   }
+   return true;
+}
+
+// true while anything is queued or on the bus
+bool
+owb_busy (void)
+{
+   return QCount != 0;
+}
@@ -0,0 +1,65 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  owbus.h   -   Interrupt driven, queued 1-wire transfers
+//
+//  History:   1.0 - First release. 
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _OWBUS_H
+#define _OWBUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define OWB_QUEUE     4         // transfers waiting at once
+#define OWB_MAX_TX    5         // bytes written after the reset, a DS18x20 scratchpad write
+#define OWB_MAX_RX    9         // bytes read, a DS18x20 scratchpad
+
+// the buses are PD4, PD5 and PD6, bus n is PORTD bit OWB_FIRST_PIN + n
+#define OWB_BUSES     3
+#define OWB_FIRST_PIN 4
+#define OWB_BUS(n)    (1 << ((n) + OWB_FIRST_PIN))
+
+// transfer status
+#define OWB_OK           0      // done, see good for which buses it worked on
+#define OWB_BUSY         1      // queued or on the bus
+#define OWB_IDLE         2      // never been queued
+
+// a reset, then ntx bytes written, then nrx bytes read, on every bus in buses at once
+typedef struct OwXfer
+{
+   uint8_t buses;               // PORTD bits of the buses, OWB_BUS(n)
+   uint8_t ntx;
+   uint8_t nrx;
+   bool crc;                    // last byte read is a CRC of the rest
+   uint8_t tx[OWB_MAX_TX];
+   uint8_t (*rx)[OWB_MAX_RX];    // OWB_BUSES rows for the bytes read, only a transfer that reads needs one
+   volatile int8_t status;
+   volatile uint8_t present;    // buses that answered the reset
+   volatile uint8_t good;       // and of those the ones that passed the CRC
+   void (*done) (struct OwXfer * x);    // called from the interrupt when finished, may be NULL
+} OwXfer;
+
+void owb_init (void);
+bool owb_queue (OwXfer * x);
+bool owb_busy (void);
+
+// true if something answered on bus n, and if the transfer worked on it
+#define owb_present(x, n) ((x)->present & OWB_BUS (n))
+#define owb_good(x, n)    ((x)->good & OWB_BUS (n))
+
+#endif
@@ -56,12 +56,19 @@ static Serial serial;
 static Term term;
 
 static const char lcd_degree[8] = { 0x1c, 0x14, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00 };  /* degree - char set B doesn't have it!! */
+static const char lcd_rising[8] = { 0x04, 0x0e, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00 };  /* up arrow */
+static const char lcd_falling[8] = { 0x04, 0x04, 0x04, 0x04, 0x15, 0x0e, 0x04, 0x00 }; /* down arrow */
 
 #define DEGREE 1
+#define RISING 2
+#define FALLING 3
 
 #define NOSIGNAL 5000
 #define BACKLIGHT 15000
 
+// a PC sends '@' then the Unix time in decimal and a CR, '@' going at the start of the second
+#define TIMESYNC '@'
+
 uint8_t addrtx0[NRF24L01_ADDRSIZE] = NRF24L01_ADDRP0;
 uint8_t addrtx1[NRF24L01_ADDRSIZE] = NRF24L01_ADDRP1;
 
@@ -97,6 +104,8 @@ init (void)
    // set up lcd display
    lcd_init ();
    lcd_remapChar (lcd_degree, DEGREE); // put the degree symbol on character 0x01
+   lcd_remapChar (lcd_rising, RISING); // and the trend arrows the base station shows on 0x02 and 0x03
+   lcd_remapChar (lcd_falling, FALLING);
 
    // terminal emulator
    term_init (&term);
@@ -121,8 +130,10 @@ main (void)
    uint16_t c = 0, r = 0, t = 0;
    uint8_t bufferin[33];
    uint8_t bufferout[33];
-   uint8_t cursor = false, x = ' ';
-   ticks_t backlight_timer, nosignal_timer;
+   uint8_t cursor = false, x = ' ', syncing = false;
+   ticks_t backlight_timer, nosignal_timer, sync_timer = 0;
+   uint32_t pctime = 0;
+   uint16_t age;
    keymask_t key;
 
 
@@ -176,10 +187,13 @@ main (void)
          // binary statistics to send out the serial port
          else if (bufferin[0] == 'S')
          {
-            uint32_t now;
-            memcpy(&now, &bufferin[1], sizeof(now));
-            memcpy(&gValues, &bufferin[5], sizeof(gValues));
-            memcpy(&gWinState, &bufferin[5 + sizeof(gValues)], sizeof(gWinState));
+            // date and time in bytes 1 to 6, then the temperatures
+            memcpy(&gValues, &bufferin[7], sizeof(gValues));
+         }
+         // vent states, then the end stop switches
+         else if (bufferin[0] == 'V')
+         {
+            memcpy(&gWinState, &bufferin[1], sizeof(gWinState));
 
          }
          // rewrite the character to the left of the cursor that we extracted earlier
@@ -201,6 +215,34 @@ main (void)
          key = kfile_getc (&serial.fd);
          if ((int16_t) key == EOF)
             key = 0;
+         // time from the PC, note when it started so we can say how old it is when it goes
+         else if (key == TIMESYNC)
+         {
+            syncing = true;
+            pctime = 0;
+            sync_timer = timer_clock ();
+            key = 0;
+         }
+         else if (syncing)
+         {
+            if ((key >= '0') && (key <= '9'))
+               pctime = pctime * 10 + key - '0';
+            else
+            {
+               syncing = false;
+               age = ticks_to_ms (timer_clock () - sync_timer);
+               if ((key == '\r') && (age < 1000))
+               {
+                  bufferout[0] = 'T';
+                  memcpy(&bufferout[1], &pctime, sizeof(pctime));
+                  memcpy(&bufferout[5], &age, sizeof(age));
+                  nrf24l01_settxaddr (addrtx1);
+                  if (nrf24l01_write (bufferout) == 0)
+                     kfile_printf(&serial.fd, "Sync TX failed, tried %d times \r\n", nrf24_retransmissionCount());
+               }
+            }
+            key = 0;
+         }
          // if alpha key (PC connected remote) then handle pseudo-long press (upper case)
          // We still just use the bit pattern of the lowest 3 bits. Candidate keys are a, b, d or i, j, l or q, r, t
          if ((key > 0x40) && (key < 0x60))
@@ -29,7 +29,9 @@
 #include <avr/eeprom.h>
 
 #include "eeprommap.h"
+#include "ds3231.h"
 #include "rtc.h"
+#include "bench.h"
 
 
 int16_t gSECOND;
@@ -39,72 +41,212 @@ int16_t gDAY;
 int16_t gMONTH;
 int16_t gYEAR;
 int16_t gAdjustTime;
+int16_t gSyncOffset;            // ms the clock was out by at the last time sync
 
 static volatile uint32_t Epoch;
 static volatile ticks_t LastTicks;
 static volatile uint32_t start_of_day;
 
+// when the next hourly journal checkpoint is due
+static uint32_t NextHour;
+// crystal trim carried between seconds (seconds a day * ticks) and ticks to take off the next second
+static int32_t Fraction;
+static int8_t Slew;
+// a DS3231 is fitted and keeps the time instead of eeprom
+static bool HwClock;
+// how far to move the start of our second when it is a second out from the DS3231 (ms)
+#define RTC_NUDGE   50
+// the epoch and day the broken down fields were last worked out for
+static uint32_t FieldsEpoch;
+static uint16_t FieldsDay;
+
+// time syncs from the remote, what our clock said and how far out it was (ms, remote - us)
+typedef struct sync
+{
+   uint32_t when;
+   int16_t offset;
+} SYNC_t;
+
+#define SYNC_HISTORY   8
+static SYNC_t SyncHist[SYNC_HISTORY];
+static uint8_t SyncCount, SyncNext;
+
+// radio and polling delay between the remote sending and us reading a sync (ms)
+#define SYNC_LATENCY   3
+// larger errors than this (seconds) just set the clock, they aren't drift
+#define SYNC_STEP      30
+// history needed before working out a new crystal trim (seconds)
+#define SYNC_SPAN      (6 * 3600L)
+
+// the date and time fields are local time (NZDT) whereas the epoch is Unix time
+#define TZ_OFFSET   46800L
+// days from 0000-03-01 to 1970-01-01 in the proleptic Gregorian calendar
+#define DAYS_TO_1970   719468L
+// days in each 400 year cycle
+#define DAYS_PER_ERA   146097L
+
+
+// days since 1st Jan 1970 from a date, no loops over the years or months
+// months are counted from March so the leap day is at the end of the year
+static uint16_t
+days_from_civil (uint16_t y, uint8_t m, uint8_t d)
+{
+   uint16_t era, yoe, doy;
+   uint32_t doe;
+
+   if (m <= 2)
+      y--;
+   era = y / 400;
+   yoe = y - era * 400;
+   doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+   doe = (uint32_t) yoe * 365 + yoe / 4 - yoe / 100 + doy;
+   return era * DAYS_PER_ERA + doe - DAYS_TO_1970;
+}
 
-#define HOUR       0
-#define MINUTE     1
-#define SECOND     2
-#define NOFLASH    3
-
-#define YEAR        0
-#define MONTH       1
-#define DAY         2
-
-
-// Lookup table holding the length of each mont. The first element is a dummy.
-//    this could be placed in progmem too, but the arrays are accessed quite
-//    often - so leaving them in RAM is better...
-char MonthLength[13] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-
+// date from the days since 1st Jan 1970, the inverse of the above
+static void
+civil_from_days (uint16_t days, uint16_t * y, uint8_t * m, uint8_t * d)
+{
+   uint32_t z = days + DAYS_TO_1970;
+   uint16_t era, yoe, doy, mp;
+   uint32_t doe;
+
+   era = z / DAYS_PER_ERA;
+   doe = z - era * DAYS_PER_ERA;
+   yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+   doy = doe - ((uint32_t) yoe * 365 + yoe / 4 - yoe / 100);
+   mp = (5 * doy + 2) / 153;
+   *d = doy - (153 * mp + 2) / 5 + 1;
+   *m = mp < 10 ? mp + 3 : mp - 9;
+   *y = yoe + era * 400 + (*m <= 2);
+}
 
-// time in seconds since midnight, 1st Jan 1970
-void
-set_epoch_time (void)
+// save the date and time so the clock isn't too far out after a reset
+static void
+save_datetime (void)
 {
-   uint8_t i;
-   uint32_t t;
    DT_t DateTime;
 
-   t = (gYEAR * 365);           // days in year
-   for (i = 0; i < gYEAR; i += 4)
-      t += 1;                   // leap years (includes 2000, excludes current year)
+   if (HwClock)
+   {
+      update_datetime ();
+      DateTime.S = gSECOND;
+      DateTime.M = gMINUTE;
+      DateTime.H = gHOUR;
+      DateTime.d = gDAY;
+      DateTime.m = gMONTH;
+      DateTime.y = gYEAR;
+      ds3231_set (&DateTime);
+   }
+   journal_save ();
+}
 
-   if ((gMONTH > 2) && ((gYEAR & 3) == 0))
-      t += 1;                   // add leap day for this leap year
+// check the date and time are in range, a blank or corrupt source gives nonsense
+static bool
+valid_datetime (const DT_t * dt)
+{
+   return dt->S <= 59 && dt->M <= 59 && dt->H <= 23 && dt->d >= 1 && dt->d <= 31 &&
+      dt->m >= 1 && dt->m <= 12 && dt->y >= 12 && dt->y <= 99;
+}
 
-   for (i = 0; i < gMONTH; i++)
-      t += MonthLength[i];      // days in month (not including this month!!)
+// Unix time from local date and time
+static uint32_t
+make_epoch (uint16_t y, uint8_t m, uint8_t d, uint8_t H, uint8_t M, uint8_t S)
+{
+   uint32_t t;
 
-   t += gDAY - 1;               // don't include today!!
+   t = days_from_civil (y + 2000, m, d);
    t *= 24;                     // days -> hours
-   t += gHOUR;
+   t += H;
    t *= 60;
-   t += gMINUTE;
+   t += M;
    t *= 60;
-   t += gSECOND;
-   t += 946638000;              // correction to base to 1970 (Unix time)
+   t += S;
+   return t - TZ_OFFSET;        // local time to Unix time
+}
+
+// the hourly checkpoint is done half a minute past the hour
+static void
+set_next_hour (void)
+{
+   NextHour = Epoch - (Epoch + TZ_OFFSET) % 3600 + 3600 + 30;
+}
 
+static void
+set_epoch (uint32_t t)
+{
 // use the difference between the new value and the old to adjust start of day
    start_of_day -= Epoch - t;
    Epoch = t;
 
-   DateTime.S = gSECOND;
-   DateTime.M = gMINUTE;
-   DateTime.H = gHOUR;
-   DateTime.d = gDAY;
-   DateTime.m = gMONTH;
-   DateTime.y = gYEAR;
-   eeprom_write_block ((const void *) &DateTime, (void *) &eeDateTime, sizeof (DateTime));
+   // work the fields out again on the next read in case they were out of range (e.g. 31st Feb)
+   FieldsEpoch = ~t;
+   FieldsDay = ~0;
+   set_next_hour ();
+}
+
+// time in seconds since midnight, 1st Jan 1970 from the date and time fields
+void
+set_epoch_time (void)
+{
+   set_epoch (make_epoch (gYEAR, gMONTH, gDAY, gHOUR, gMINUTE, gSECOND));
+   save_datetime ();
+}
 
+// keep in step with the DS3231, called just after our second has ticked over
+// a second or more out is a step, exactly one out is the two seconds not lining up so move ours a little
+static void
+discipline (void)
+{
+   DT_t DateTime;
+   int32_t diff;
+
+   if (ds3231_get (&DateTime) || !valid_datetime (&DateTime))
+      return;
+
+   diff = make_epoch (DateTime.y, DateTime.m, DateTime.d, DateTime.H, DateTime.M, DateTime.S) - Epoch;
+   if (diff > 1 || diff < -1)
+      set_epoch (Epoch + diff);
+   else if (diff == 1)
+      LastTicks -= ms_to_ticks (RTC_NUDGE);
+   else if (diff == -1)
+      LastTicks += ms_to_ticks (RTC_NUDGE);
+}
+
+// work out the date and time fields from the epoch if it has moved on since they were last read
+// the date is only worked out again when the day changes
+void
+update_datetime (void)
+{
+   uint32_t now = Epoch + TZ_OFFSET;
+   uint16_t day, secs, y;
+   uint8_t m, d;
+
+   if (Epoch == FieldsEpoch)
+      return;
+   FieldsEpoch = Epoch;
+
+   day = now / 86400;
+   secs = (now % 86400) / 2;    // in 2 second units to fit 16 bits
+   gHOUR = secs / 1800;
+   secs -= gHOUR * 1800;
+   gMINUTE = secs / 30;
+   gSECOND = (secs - gMINUTE * 30) * 2 + (now & 1);
+
+   if (day != FieldsDay)
+   {
+      FieldsDay = day;
+      civil_from_days (day, &y, &m, &d);
+      gDAY = d;
+      gMONTH = m;
+      gYEAR = y - 2000;
+   }
 }
 
 void
 get_datetime (uint16_t * year, uint8_t * month, uint8_t * day, uint8_t * hour, uint8_t * min, uint8_t * sec)
 {
+   update_datetime ();
    *sec = gSECOND;
    *min = gMINUTE;
    *hour = gHOUR;
@@ -114,6 +256,113 @@ get_datetime (uint16_t * year, uint8_t * month, uint8_t * day, uint8_t * hour, u
 
 }
 
+// work out a new crystal trim from the drift seen over the sync history
+// each sync corrected the clock, so the offsets after the oldest add up to the drift over the span
+static void
+sync_trim (void)
+{
+   uint8_t i, idx;
+   uint32_t span;
+   int32_t drift = 0;
+   int16_t trim;
+
+   idx = (SyncNext + SYNC_HISTORY - SyncCount) % SYNC_HISTORY;
+   span = SyncHist[(SyncNext + SYNC_HISTORY - 1) % SYNC_HISTORY].when - SyncHist[idx].when;
+   if (SyncCount < 3 || span < SYNC_SPAN)
+      return;
+
+   for (i = 1; i < SyncCount; i++)
+      drift += SyncHist[(idx + i) % SYNC_HISTORY].offset;
+
+   // ms over the span -> seconds per day, rounded
+   trim = (drift * 864L + (drift < 0 ? -5L : 5L) * span) / (10L * span);
+   if (trim == 0)
+      return;
+
+   gAdjustTime += trim;
+   if (gAdjustTime > 719)
+      gAdjustTime = 719;
+   if (gAdjustTime < -719)
+      gAdjustTime = -719;
+   save_eeprom_value (&gAdjustTime);
+
+   // the older offsets were with the old trim, start again from the latest
+   SyncCount = 1;
+}
+
+// a time stamp from the remote (Unix time) that was 'age' ms old when it was sent
+// correct the clock to it and keep the offset to work out the crystal trim
+void
+rtc_sync (uint32_t remote, uint16_t age)
+{
+   int32_t offset;
+   int16_t secs;
+
+   // where the remote says we should be in ms from the start of our current second
+   age += SYNC_LATENCY;
+   offset = (int32_t) (remote - Epoch);
+
+   if (offset > SYNC_STEP || offset < -SYNC_STEP)
+   {
+      // way out, e.g. after a power cut, so set it and forget the history
+      start_of_day += remote - Epoch;
+      Epoch = remote;
+      LastTicks = timer_clock () - ms_to_ticks (age % 1000);
+      Epoch += age / 1000;
+      start_of_day += age / 1000;
+      SyncCount = 0;
+      gSyncOffset = offset > 0 ? INT16_MAX : INT16_MIN;
+   }
+   else
+   {
+      offset = offset * 1000 + age - ticks_to_ms (timer_clock () - LastTicks);
+      // near the step limit with a stale sync the ms no longer fit 16 bits, report them saturated
+      if (offset > INT16_MAX)
+         gSyncOffset = INT16_MAX;
+      else if (offset < INT16_MIN)
+         gSyncOffset = INT16_MIN;
+      else
+         gSyncOffset = offset;
+
+      // whole seconds on the epoch (uptime stays put), the rest by moving the start of this second
+      secs = offset / 1000;
+      Epoch += secs;
+      start_of_day += secs;
+      LastTicks -= ms_to_ticks (offset - secs * 1000L);
+
+      // the DS3231 keeps its own time so the drift history is only for our crystal. An offset
+      // too big for the history is treated like a step and the history started again
+      if (!HwClock && gSyncOffset != offset)
+         SyncCount = 0;
+      else if (!HwClock)
+      {
+         SyncHist[SyncNext].when = Epoch;
+         SyncHist[SyncNext].offset = offset;
+         SyncNext = (SyncNext + 1) % SYNC_HISTORY;
+         if (SyncCount < SYNC_HISTORY)
+            SyncCount++;
+         sync_trim ();
+      }
+   }
+
+   FieldsEpoch = ~Epoch;
+   set_next_hour ();
+   save_datetime ();
+}
+
+// day number (local time) of a time, for anything that needs to know when the date changes
+uint16_t
+day_number (uint32_t t)
+{
+   return (t + TZ_OFFSET) / 86400;
+}
+
+uint16_t
+today (void)
+{
+   return day_number (Epoch);
+}
+
 uint32_t
 uptime (void)
 {
@@ -137,18 +386,29 @@ rtc_init (void)
 {
    DT_t DateTime;
 
-   // initial time and date setting
-   eeprom_read_block ((void *) &DateTime, (const void *) &eeDateTime, sizeof (DateTime));
-   eeprom_read_block ((void *) &gAdjustTime, (const void *) &eeAdjustTime, sizeof (gAdjustTime));
-   gSECOND = DateTime.S;
-   gMINUTE = DateTime.M;
-   gHOUR = DateTime.H;
-   gDAY = DateTime.d;
-   gMONTH = DateTime.m;
-   gYEAR = DateTime.y;
-
+   // initial time and date setting, from the DS3231 if there is one and it has kept going,
+   // otherwise the last journal record or failing that the date and time saved before there was a journal
    LastTicks = timer_clock ();
-   set_epoch_time ();
+   HwClock = ds3231_init () == 0;
+   if (HwClock && ds3231_get (&DateTime) == 0 && valid_datetime (&DateTime))
+      set_epoch (make_epoch (DateTime.y, DateTime.m, DateTime.d, DateTime.H, DateTime.M, DateTime.S));
+   else if (gJournal.epoch)
+      set_epoch (gJournal.epoch);
+   else
+   {
+      eeprom_read_block ((void *) &DateTime, (const void *) &eeDateTime, sizeof (DateTime));
+
+      // start from somewhere sensible if that was nonsense too
+      if (!valid_datetime (&DateTime))
+      {
+         DateTime.S = DateTime.M = 0;
+         DateTime.H = 12;
+         DateTime.d = 1;
+         DateTime.m = 1;
+         DateTime.y = 20;
+      }
+      set_epoch (make_epoch (DateTime.y, DateTime.m, DateTime.d, DateTime.H, DateTime.M, DateTime.S));
+   }
    start_of_day = Epoch;
 }
 
@@ -176,12 +436,10 @@ time (void)
 void
 run_rtc (void)
 {
-   int8_t LeapMonth;
    int32_t diff;
-   static int16_t lastHour = 0;
 
-   // find out how far off the exact number of ticks we are
-   diff = timer_clock () - LastTicks - ms_to_ticks (1000);
+   // find out how far off the exact number of ticks we are, allowing for the crystal trim
+   diff = timer_clock () - LastTicks - (ms_to_ticks (1000) - Slew);
    if (diff < 0)
       return;
 
@@ -190,62 +448,51 @@ run_rtc (void)
 
    Epoch++;                     // count seconds since epoch (1st Jan 1970)
 
-   gSECOND++;                   // increment second
-
-   if (gSECOND == 60)
+   // the DS3231 is temperature compensated, follow it every minute rather than trimming our crystal
+   if (HwClock)
    {
-      gSECOND = 0;
-      gMINUTE++;
-
-      if (gMINUTE > 59)
-      {
-         gMINUTE = 0;
-         gHOUR++;
-
-         if (gHOUR > 23)
-         {
-            gHOUR = 0;
-            gDAY++;
-
-            // Check for leap year if month == February
-            if (gMONTH == 2)
-               if (!(gYEAR & 0x0003))   // if (gYEAR%4 == 0)
-                  LeapMonth = 1;
-               else
-                  LeapMonth = 0;
-            else
-               LeapMonth = 0;
-
-            // Now, we can check for month length
-            if (gDAY > (MonthLength[gMONTH] + LeapMonth))
-            {
-               gDAY = 1;
-               gMONTH++;
-
-               if (gMONTH > 12)
-               {
-                  gMONTH = 1;
-                  gYEAR++;
-               }
-            }
-         }
-         // save time to eeprom on the hour
-         set_epoch_time ();
-      }
+      if ((Epoch + TZ_OFFSET) % 60 == 30)
+         discipline ();
    }
-
-   // still looking at the top of the hour but everything has been updated by now
-   // adjust time for slow/fast crystal every hour when minutes are zero and seconds are half way
-   // this allows 30 * 24 seconds adjustment per day (i.e. +/- 720) without messing with minute under/overruns
-   // remember at what hour we did any change so we only do it once!
-   if ((gMINUTE == 0) && (gSECOND == 30) && (lastHour != gHOUR))
+   else
    {
-      gSECOND += gAdjustTime / 24;
-      lastHour = gHOUR;
-      // once a day adjust time for any remaining seconds where hourly changes loose resolution
-      if (gHOUR == 0)
-      {
-         gSECOND += gAdjustTime % 24;
-      }
+      // correct for a slow/fast crystal a tick at a time rather than jumping the seconds
+      // gAdjustTime seconds a day is gAdjustTime * ticks per second spread over 86400 seconds,
+      // i.e. about 11.6ppm per second a day and up to 8 ticks on any one second at the +/- 719 limit
+      Fraction += (int32_t) gAdjustTime * (int32_t) ms_to_ticks (1000);
+      Slew = Fraction / 86400L;
+      Fraction -= Slew * 86400L;
    }
+
+   if (Epoch < NextHour)
+      return;
+   NextHour += 3600;
+
+   // checkpoint the time and today's counters in the eeprom journal every hour
+   journal_save ();
+}
+
+
+#ifdef BENCH
+// a plain second, a second that ends the hour and the fields worked out across midnight
+void
+rtc_bench (void)
+{
+   uint32_t saved = Epoch;
+
+   Slew = 0;
+   LastTicks = timer_clock () - ms_to_ticks (1000);
+   BENCH_RUN ("run_rtc second", run_rtc ());
+
+   NextHour = Epoch + 1;
+   LastTicks = timer_clock () - ms_to_ticks (1000);
+   BENCH_RUN ("run_rtc hour", run_rtc ());
+
+   set_epoch (Epoch - (Epoch + TZ_OFFSET) % 86400 + 86400);
+   BENCH_RUN ("update_datetime day", update_datetime ());
+   Epoch++;
+   BENCH_RUN ("update_datetime second", update_datetime ());
+
+   set_epoch (saved);
 }
+#endif
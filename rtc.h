@@ -30,6 +30,7 @@ extern int16_t gDAY;
 extern int16_t gMONTH;
 extern int16_t gYEAR;
 extern int16_t gAdjustTime;
+extern int16_t gSyncOffset;
 
 typedef struct datetime
 {
@@ -49,7 +50,11 @@ void run_rtc (void);            //updates the time and date
 // time in seconds since midnight, 1st Jan 2000
 uint32_t time (void);
 void set_epoch_time (void);
+void update_datetime (void);
 void get_datetime (uint16_t * year, uint8_t * month, uint8_t * day, uint8_t * hour, uint8_t * min, uint8_t * sec);
+void rtc_sync (uint32_t remote, uint16_t age);
+uint16_t day_number (uint32_t t);
+uint16_t today (void);
 uint32_t uptime (void);
 
 #endif
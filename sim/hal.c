@@ -0,0 +1,371 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  hal.c   -   Trace replay simulator - the hardware and BeRTOS drivers seen by the firmware
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <algo/crc8.h>
+#include <io/kfile.h>
+#include <drv/timer.h>
+#include <drv/ow_1wire.h>
+#include <drv/ow_ds18x20.h>
+#include <drv/ow_ds2413.h>
+
+#include "sim.h"
+#include "owbus.h"
+
+
+volatile uint8_t PORTB, DDRB, PINB;
+volatile uint8_t PORTD, DDRD, PIND;
+volatile uint8_t ADMUX;
+
+ticks_t sim_ticks;
+uint32_t sim_eeprom_writes;
+bool sim_endstops;
+
+
+/* System timer */
+
+ticks_t
+timer_clock (void)
+{
+   return sim_ticks;
+}
+
+
+// watchdog.c is not built, only the boot times are wanted from it
+int16_t gBootControl;
+
+void
+boot_mark (int16_t * mark)
+{
+   if (*mark == 0)
+      *mark = ticks_to_ms (sim_ticks) ? ticks_to_ms (sim_ticks) : 1;
+}
+
+
+// kept here as rtc.h has its own time()
+double
+sim_cputime (void)
+{
+   return (double) clock () / CLOCKS_PER_SEC;
+}
+
+
+/* ADC - a conversion is always ready */
+
+static volatile uint8_t adcsra;
+
+volatile uint8_t *
+sim_adcsra (void)
+{
+   adcsra |= BV (ADIF);
+   return &adcsra;
+}
+
+// turn the millivolts on the selected pin into ADC counts against the 5V reference
+uint16_t
+sim_adc (void)
+{
+   uint32_t mv = sim_analog (ADMUX & 0x07);
+
+   if (mv > 5000)
+      mv = 5000;
+   return (mv * 1023 + 2500) / 5000;
+}
+
+
+/* eeprom - the EEMEM variables themselves are the eeprom */
+
+extern uint8_t __start_sim_eeprom[];
+extern uint8_t __stop_sim_eeprom[];
+
+// writes to each byte, the ATmega328p is good for about 100k
+static uint32_t wear[1024];
+// when the last byte write started, each takes 3.3ms
+static ticks_t written;
+
+// erased eeprom reads as all ones
+void
+sim_eeprom_erase (void)
+{
+   memset (__start_sim_eeprom, 0xff, __stop_sim_eeprom - __start_sim_eeprom);
+   memset (wear, 0, sizeof (wear));
+   sim_eeprom_writes = 0;
+}
+
+// writes to the most written byte
+uint32_t
+sim_eeprom_wear (void)
+{
+   uint32_t most = 0;
+   size_t i;
+
+   for (i = 0; i < sizeof (wear) / sizeof (wear[0]); i++)
+      if (wear[i] > most)
+         most = wear[i];
+   return most;
+}
+
+void
+eeprom_read_block (void *dst, const void *src, size_t n)
+{
+   memcpy (dst, src, n);
+}
+
+void
+eeprom_write_block (const void *src, void *dst, size_t n)
+{
+   const uint8_t *s = src;
+   uint8_t *d = dst;
+
+   while (n--)
+      eeprom_write_byte (d++, *s++);
+}
+
+void
+eeprom_update_block (const void *src, void *dst, size_t n)
+{
+   const uint8_t *s = src;
+   uint8_t *d = dst;
+
+   while (n--)
+      eeprom_update_byte (d++, *s++);
+}
+
+int
+eeprom_is_ready (void)
+{
+   return sim_ticks - written >= 4;
+}
+
+uint8_t
+eeprom_read_byte (const uint8_t * addr)
+{
+   return *addr;
+}
+
+void
+eeprom_write_byte (uint8_t * addr, uint8_t value)
+{
+   *addr = value;
+   written = sim_ticks;
+   wear[addr - __start_sim_eeprom]++;
+   sim_eeprom_writes++;
+}
+
+void
+eeprom_update_byte (uint8_t * addr, uint8_t value)
+{
+   if (*addr != value)
+      eeprom_write_byte (addr, value);
+}
+
+
+/* Dallas crc8 */
+
+uint8_t
+crc8 (const uint8_t * data, size_t len)
+{
+   uint8_t crc = 0, i, b;
+
+   while (len--)
+   {
+      b = *data++;
+      for (i = 0; i < 8; i++)
+      {
+         if ((crc ^ b) & 1)
+            crc = (crc >> 1) ^ 0x8c;
+         else
+            crc >>= 1;
+         b >>= 1;
+      }
+   }
+   return crc;
+}
+
+
+/* Serial debug goes to stdout */
+
+int
+kfile_printf (KFile * fd, const char *fmt, ...)
+{
+   va_list ap;
+   int ret;
+
+   (void) fd;
+   va_start (ap, fmt);
+   ret = vprintf (fmt, ap);
+   va_end (ap);
+   return ret;
+}
+
+size_t
+kfile_write (KFile * fd, const void *buf, size_t size)
+{
+   (void) fd;
+   return fwrite (buf, 1, size, stdout);
+}
+
+
+/* 1-wire - one sensor on each of PD4, PD5 and PD6 with a DS2413 on the vent buses if fitted */
+
+static uint8_t bus;
+
+uint8_t
+ow_set_bus (volatile void *in, volatile void *out, volatile void *ddr, uint8_t pin)
+{
+   (void) in;
+   (void) out;
+   (void) ddr;
+   bus = pin - PD4;
+   return ow_reset ();
+}
+
+uint8_t
+ow_reset (void)
+{
+   return 0;
+}
+
+// conversions are finished by the time the firmware comes back to a bus
+uint8_t
+ow_busy (void)
+{
+   return 0;
+}
+
+uint8_t
+ow_rom_search (uint8_t diff, uint8_t * id)
+{
+   (void) diff;
+   if (!sim_endstops || (bus > 1))
+      return OW_PRESENCE_ERR;
+   memset (id, 0, OW_ROMCODE_SIZE);
+   id[0] = 0x3A;
+   id[1] = bus;
+   id[7] = crc8 (id, OW_ROMCODE_SIZE - 1);
+   return OW_LAST_DEVICE;
+}
+
+int
+ow_ds18x20_resolution (uint8_t * id, uint8_t bits)
+{
+   (void) id;
+   (void) bits;
+   return true;
+}
+
+int
+ow_ds18X20_start (uint8_t * id, bool parasitic)
+{
+   (void) id;
+   (void) parasitic;
+   return true;
+}
+
+int
+ow_ds18X20_read_temperature (uint8_t * id, int16_t * temperature)
+{
+   (void) id;
+   *temperature = sim_temperature (bus);
+   return true;
+}
+
+/* the interrupt driven transfers finish as soon as they are queued, a scratchpad read gets
+   the temperature of each bus in 1/16 degree like a DS18B20 */
+
+void
+owb_init (void)
+{
+}
+
+bool
+owb_queue (OwXfer * x)
+{
+   int16_t t;
+   uint8_t n, *rx;
+
+   x->status = OWB_OK;
+   x->present = x->buses;
+   x->good = x->buses;
+   for (n = 0; n < OWB_BUSES && x->nrx; n++)
+   {
+      rx = x->rx[n];
+      memset (rx, 0, x->nrx);
+      t = sim_temperature (n);
+      t = (t >= 0 ? t * 16 + 50 : t * 16 - 50) / 100;
+      rx[0] = t & 0xff;
+      rx[1] = t >> 8;
+      rx[4] = 0x5f;             // 11 bit resolution
+      rx[x->nrx - 1] = crc8 (rx, x->nrx - 1);
+   }
+   if (x->done)
+      x->done (x);
+   return true;
+}
+
+bool
+owb_busy (void)
+{
+   return false;
+}
+
+int
+ow_ds2413_read (uint8_t * id)
+{
+   return sim_switches (id[1]);
+}
+
+int
+ow_ds2413_write (uint8_t * id, uint8_t data)
+{
+   (void) id;
+   (void) data;
+   return true;
+}
+
+/* no DS3231 on the i2c bus, the clock runs from eeprom and gAdjustTime */
+/* (rtc.h clashes with <time.h> so the date and time struct is left opaque) */
+
+struct datetime;
+
+int8_t
+ds3231_init (void)
+{
+   return -1;
+}
+
+int8_t
+ds3231_get (struct datetime * dt)
+{
+   (void) dt;
+   return -1;
+}
+
+int8_t
+ds3231_set (const struct datetime * dt)
+{
+   (void) dt;
+   return -1;
+}
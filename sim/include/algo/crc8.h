@@ -0,0 +1,28 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  algo/crc8.h   -   Simulator stand in for the BeRTOS Dallas crc8
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _SIM_ALGO_CRC8_H
+#define _SIM_ALGO_CRC8_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint8_t crc8 (const uint8_t * data, size_t len);
+
+#endif
@@ -0,0 +1,37 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  avr/eeprom.h   -   Simulator stand in for the AVR eeprom library
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _SIM_AVR_EEPROM_H
+#define _SIM_AVR_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// eeprom variables live in their own section so the simulator can erase it and count writes
+#define EEMEM __attribute__ ((section ("sim_eeprom")))
+
+void eeprom_read_block (void *dst, const void *src, size_t n);
+void eeprom_write_block (const void *src, void *dst, size_t n);
+void eeprom_update_block (const void *src, void *dst, size_t n);
+uint8_t eeprom_read_byte (const uint8_t * addr);
+void eeprom_write_byte (uint8_t * addr, uint8_t value);
+void eeprom_update_byte (uint8_t * addr, uint8_t value);
+int eeprom_is_ready (void);
+
+#endif
@@ -0,0 +1,51 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  avr/io.h   -   Simulator stand in for the AVR registers used by the firmware
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _SIM_AVR_IO_H
+#define _SIM_AVR_IO_H
+
+#include <stdint.h>
+
+// plain registers, the simulator looks at the port bits to see what the motors are doing
+extern volatile uint8_t PORTB, DDRB, PINB;
+extern volatile uint8_t PORTD, DDRD, PIND;
+extern volatile uint8_t ADMUX;
+
+// the ADC always has a conversion ready and returns the simulated input on the selected channel
+volatile uint8_t *sim_adcsra (void);
+uint16_t sim_adc (void);
+#define ADCSRA   (*sim_adcsra ())
+#define ADC      (sim_adc ())
+
+#define PD2      2
+#define PD3      3
+#define PD4      4
+#define PD5      5
+#define PD6      6
+#define PD7      7
+
+#define REFS0    6
+#define ADEN     7
+#define ADSC     6
+#define ADIF     4
+#define ADPS2    2
+#define ADPS1    1
+#define ADPS0    0
+
+#endif
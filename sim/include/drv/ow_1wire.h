@@ -0,0 +1,38 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  drv/ow_1wire.h   -   Simulator stand in for the BeRTOS 1-wire bus driver
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _SIM_DRV_OW_1WIRE_H
+#define _SIM_DRV_OW_1WIRE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define OW_ROMCODE_SIZE  8
+
+#define OW_SEARCH_FIRST  0xFF
+#define OW_PRESENCE_ERR  0xFF
+#define OW_DATA_ERR      0xFE
+#define OW_LAST_DEVICE   0x00
+
+uint8_t ow_set_bus (volatile void *in, volatile void *out, volatile void *ddr, uint8_t pin);
+uint8_t ow_reset (void);
+uint8_t ow_busy (void);
+uint8_t ow_rom_search (uint8_t diff, uint8_t * id);
+
+#endif
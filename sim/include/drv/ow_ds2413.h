@@ -0,0 +1,28 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  drv/ow_ds2413.h   -   Simulator stand in for the BeRTOS DS2413 switch driver
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _SIM_DRV_OW_DS2413_H
+#define _SIM_DRV_OW_DS2413_H
+
+#include <stdint.h>
+
+int ow_ds2413_read (uint8_t * id);
+int ow_ds2413_write (uint8_t * id, uint8_t data);
+
+#endif
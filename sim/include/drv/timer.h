@@ -0,0 +1,36 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  drv/timer.h   -   Simulator stand in for the BeRTOS system timer, one tick per simulated millisecond
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _SIM_DRV_TIMER_H
+#define _SIM_DRV_TIMER_H
+
+#include <stdint.h>
+#include <cfg/macros.h>
+#include <avr/io.h>
+
+typedef int32_t ticks_t;
+typedef int32_t mtime_t;
+
+#define TIMER_TICKS_PER_SEC  1000
+#define ms_to_ticks(ms)      ((ticks_t) (ms))
+#define ticks_to_ms(ticks)   ((mtime_t) (ticks))
+
+ticks_t timer_clock (void);
+
+#endif
@@ -0,0 +1,34 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  io/kfile.h   -   Simulator stand in for the BeRTOS file interface, output goes to stdout
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _SIM_IO_KFILE_H
+#define _SIM_IO_KFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct KFile
+{
+   int unused;
+} KFile;
+
+int kfile_printf (KFile * fd, const char *fmt, ...);
+size_t kfile_write (KFile * fd, const void *buf, size_t size);
+
+#endif
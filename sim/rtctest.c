@@ -0,0 +1,76 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  rtctest.c   -   Checks the clock's calendar arithmetic against the C library's gmtime
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <stdio.h>
+#include <time.h>
+
+#include "rtcwrap.h"
+
+
+// every day a 16 bit day count can hold (1970 to 2149) both ways, then the date and time fields
+// of a Unix time every 3607 seconds (so the time of day keeps moving) up to 2106
+int
+main (void)
+{
+   uint32_t day, days, errors = 0;
+   uint64_t t;
+   uint16_t y;
+   uint8_t m, d;
+   int16_t f[6];
+   time_t tt;
+   struct tm tm;
+
+   for (day = 0; day <= 0xffff; day++)
+   {
+      tt = (time_t) day * 86400;
+      gmtime_r (&tt, &tm);
+      days = wrap_days_from_civil (tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+      wrap_civil_from_days (day, &y, &m, &d);
+      if (days != day || y != tm.tm_year + 1900 || m != tm.tm_mon + 1 || d != tm.tm_mday)
+      {
+         if (errors++ < 10)
+            printf ("day %u: %04d-%02d-%02d gives %u, back to %04u-%02u-%02u\n", day,
+                    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, days, y, m, d);
+      }
+   }
+
+   // the fields are worked out from local time in 32 bits, which runs out 13 hours before Unix time
+   for (t = 0; t + wrap_tz_offset () <= 0xffffffffUL; t += 3607)
+   {
+      tt = t + wrap_tz_offset ();
+      gmtime_r (&tt, &tm);
+      wrap_fields (t, f);
+      if (f[0] != tm.tm_year + 1900 || f[1] != tm.tm_mon + 1 || f[2] != tm.tm_mday ||
+          f[3] != tm.tm_hour || f[4] != tm.tm_min || f[5] != tm.tm_sec)
+      {
+         if (errors++ < 10)
+            printf ("time %lu: %04d-%02d-%02d %02d:%02d:%02d gives %04d-%02d-%02d %02d:%02d:%02d\n",
+                    (unsigned long) t, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                    tm.tm_min, tm.tm_sec, f[0], f[1], f[2], f[3], f[4], f[5]);
+      }
+   }
+
+   if (errors)
+   {
+      printf ("rtctest: %u errors\n", errors);
+      return 1;
+   }
+   printf ("rtctest: calendar matches gmtime\n");
+   return 0;
+}
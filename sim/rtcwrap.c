@@ -0,0 +1,112 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  rtcwrap.c   -   rtc.c built on its own so rtctest can get at its calendar code
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// rtc.c has its own time() so this is kept apart from the libc <time.h> used by rtctest.c
+#include <string.h>
+
+#include "../rtc.c"
+
+#include "rtcwrap.h"
+
+
+// just enough of the rest of the firmware for rtc.c to link
+
+DT_t EEMEM eeDateTime;
+JR_t gJournal;
+
+ticks_t
+timer_clock (void)
+{
+   return 0;
+}
+
+void
+eeprom_read_block (void *dst, const void *src, size_t n)
+{
+   memcpy (dst, src, n);
+}
+
+void
+save_eeprom_value (const void *var)
+{
+   (void) var;
+}
+
+void
+journal_save (void)
+{
+}
+
+int8_t
+ds3231_init (void)
+{
+   return -1;
+}
+
+int8_t
+ds3231_get (DT_t * dt)
+{
+   (void) dt;
+   return -1;
+}
+
+int8_t
+ds3231_set (const DT_t * dt)
+{
+   (void) dt;
+   return -1;
+}
+
+
+// the static calendar code
+
+uint16_t
+wrap_days_from_civil (uint16_t y, uint8_t m, uint8_t d)
+{
+   return days_from_civil (y, m, d);
+}
+
+void
+wrap_civil_from_days (uint16_t days, uint16_t * y, uint8_t * m, uint8_t * d)
+{
+   civil_from_days (days, y, m, d);
+}
+
+// local date and time fields for a Unix time, as the UI and radio see them
+void
+wrap_fields (uint32_t t, int16_t * fields)
+{
+   // make sure both the time and the date get worked out afresh
+   Epoch = t;
+   FieldsEpoch = ~t;
+   FieldsDay = (t + TZ_OFFSET) / 86400 + 1;
+   update_datetime ();
+   fields[0] = gYEAR + 2000;
+   fields[1] = gMONTH;
+   fields[2] = gDAY;
+   fields[3] = gHOUR;
+   fields[4] = gMINUTE;
+   fields[5] = gSECOND;
+}
+
+uint32_t
+wrap_tz_offset (void)
+{
+   return TZ_OFFSET;
+}
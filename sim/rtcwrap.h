@@ -0,0 +1,30 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  rtcwrap.h   -   rtc.c calendar code made visible to rtctest
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _RTCWRAP_H
+#define _RTCWRAP_H
+
+#include <stdint.h>
+
+uint16_t wrap_days_from_civil (uint16_t y, uint8_t m, uint8_t d);
+void wrap_civil_from_days (uint16_t days, uint16_t * y, uint8_t * m, uint8_t * d);
+void wrap_fields (uint32_t t, int16_t * fields);
+uint32_t wrap_tz_offset (void);
+
+#endif
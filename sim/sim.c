@@ -0,0 +1,492 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  sim.c   -   Trace replay simulator - runs the real measurement and window control code against
+//              recorded or synthetic temperature, current and battery traces much faster than real time
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+#include "measure.h"
+#include "rtc.h"
+#include "eeprommap.h"
+#include "window.h"
+
+#include "sim.h"
+
+
+// the firmware main loop runs this often in simulated time
+#define STEP_MS     100
+#define STEP        (STEP_MS / 1000.0)
+
+// motor currents in mA
+#define I_RUN       1500.0      // vent moving
+#define I_INRUSH    3000.0      // for the first half second
+#define I_STALL     3500.0      // wound in against the closed stop
+#define I_SLACK     300.0       // unwound with the cable slack
+
+// owned by modules the simulator doesn't build (ui.c and nrf.c)
+int16_t gBacklight;
+int16_t gRadio;
+
+// boot() saves every setting so there is nothing for the UI to put right
+void
+ui_check_value (int16_t * var, bool missing)
+{
+   (void) var;
+   (void) missing;
+}
+
+
+typedef struct
+{
+   double pos;                  // 0 closed to 1 fully open
+   double travel;               // seconds from closed to open
+   int8_t motor;                // 1 opening, -1 closing, 0 off
+   double ontime;               // how long the motor has been on
+   double current;              // mA
+   // results
+   uint32_t starts;
+   double ampsecs;
+   double hot;                  // seconds over the open limit
+   double cold;                 // seconds under the close limit
+} Vent;
+
+typedef struct
+{
+   double t;                    // seconds from the start
+   double temp[NUMSENSORS];     // degrees C
+   double battery;              // volts
+   double current[2];           // amps, NAN if not recorded
+} Sample;
+
+
+static Vent vent[2];
+static double temp[NUMSENSORS];
+static double battery = 12.6;
+
+static Sample *trace;
+static size_t trace_len, trace_idx;
+
+static double house;            // synthetic model air temperature
+static double cloud = 1.0;      // sunshine factor for the day
+static uint32_t seed = 1;
+
+
+// repeatable noise so runs can be compared
+static double
+noise (void)
+{
+   seed = seed * 1103515245 + 12345;
+   return ((seed >> 16) & 0x7fff) / 16384.0 - 1.0;
+}
+
+
+/* What the firmware sees of the model */
+
+// DS18B20 reading at 1/8 degree resolution
+int16_t
+sim_temperature (uint8_t sensor)
+{
+   return (int16_t) (floor (temp[sensor] * 8.0 + 0.5) * 100.0 / 8.0);
+}
+
+uint16_t
+sim_analog (uint8_t chan)
+{
+   switch (chan)
+   {
+   case 3:
+      return vent[SENSOR_LOW].current * RSHUNTDN;
+   case 7:
+      return vent[SENSOR_HIGH].current * RSHUNTUP;
+   case 6:
+      return battery * 1000.0 / V_SCALE;
+   }
+   return 0;
+}
+
+// switches pull their PIO pin low when made, PIOA fully open, PIOB fully closed
+uint8_t
+sim_switches (uint8_t v)
+{
+   uint8_t pio = 0x0f;
+
+   if (vent[v].pos >= 1.0)
+      pio &= ~0x01;
+   if (vent[v].pos <= 0.0)
+      pio &= ~0x04;
+   return pio;
+}
+
+
+/* The vent and tunnel house model */
+
+// read the motor drive pins the way window.c sets them
+static void
+read_motors (void)
+{
+   int8_t lo = 0, hi = 0;
+
+   if (PORTD & BV (2))
+      lo = 1;
+   if (PORTD & BV (7))
+      lo = -1;
+   if (PORTD & BV (3))
+      hi = 1;
+   if (PORTB & BV (0))
+      hi = -1;
+
+   if (lo && !vent[SENSOR_LOW].motor)
+      vent[SENSOR_LOW].starts++;
+   if (hi && !vent[SENSOR_HIGH].motor)
+      vent[SENSOR_HIGH].starts++;
+   vent[SENSOR_LOW].motor = lo;
+   vent[SENSOR_HIGH].motor = hi;
+}
+
+static void
+move_vent (Vent * v, double recorded)
+{
+   if (!v->motor)
+   {
+      v->ontime = 0;
+      v->current = 0;
+      return;
+   }
+
+   v->ontime += STEP;
+   v->pos += v->motor * STEP / v->travel;
+   if (v->pos > 1.0)
+      v->pos = 1.0;
+   if (v->pos < 0.0)
+      v->pos = 0.0;
+
+   if (!isnan (recorded))
+      v->current = recorded * 1000.0;
+   else if (v->ontime < 0.5)
+      v->current = I_INRUSH;
+   else if ((v->motor > 0) && (v->pos >= 1.0))
+      v->current = I_SLACK;
+   else if ((v->motor < 0) && (v->pos <= 0.0))
+      v->current = I_STALL;
+   else
+      v->current = I_RUN * (1.0 + 0.05 * noise ());
+
+   v->ampsecs += v->current * STEP / 1000.0;
+}
+
+// a day of weather - outside temperature swings about a mean, the sun warms the house from 6am to 6pm
+// and open vents pull the house back towards the outside temperature
+static void
+synthetic (double t)
+{
+   double hour = fmod (t / 3600.0, 24.0);
+   double sun, vents;
+
+   if (fmod (t, 86400.0) < STEP)
+      cloud = 0.4 + 0.6 * fabs (noise ());
+
+   temp[SENSOR_OUT] = 14.0 + 7.0 * sin ((hour - 9.0) * M_PI / 12.0) + 0.05 * noise ();
+   sun = (hour > 6.0) && (hour < 18.0) ? cloud * sin ((hour - 6.0) * M_PI / 12.0) : 0.0;
+   vents = vent[SENSOR_LOW].pos / 600.0 + vent[SENSOR_HIGH].pos / 400.0;
+
+   house += STEP * (sun * 0.0065 + (temp[SENSOR_OUT] - house) * (1.0 / 3600.0 + vents));
+   temp[SENSOR_LOW] = house - 0.5 + 0.05 * noise ();
+   temp[SENSOR_HIGH] = house + 1.5 * sun + 0.05 * noise ();
+   battery = 12.4 + 0.9 * sun - (vent[SENSOR_LOW].current + vent[SENSOR_HIGH].current) / 10000.0;
+}
+
+// step through the recorded trace, holding each sample until the next one
+static void
+replay (double t)
+{
+   uint8_t i;
+
+   while ((trace_idx + 1 < trace_len) && (trace[trace_idx + 1].t <= t))
+      trace_idx++;
+   for (i = 0; i < NUMSENSORS; i++)
+      temp[i] = trace[trace_idx].temp[i];
+   battery = trace[trace_idx].battery;
+}
+
+// seconds,lower,upper,outside,battery[,lower amps,upper amps] - lines starting with # are ignored
+static void
+load_trace (const char *name)
+{
+   FILE *f = fopen (name, "r");
+   char line[256];
+   size_t size = 0;
+   Sample s;
+   int n;
+
+   if (!f)
+   {
+      perror (name);
+      exit (1);
+   }
+   while (fgets (line, sizeof (line), f))
+   {
+      if (line[0] == '#')
+         continue;
+      n = sscanf (line, "%lf,%lf,%lf,%lf,%lf,%lf,%lf", &s.t, &s.temp[SENSOR_LOW], &s.temp[SENSOR_HIGH],
+                  &s.temp[SENSOR_OUT], &s.battery, &s.current[SENSOR_LOW], &s.current[SENSOR_HIGH]);
+      if (n < 5)
+         continue;
+      if (n < 7)
+         s.current[SENSOR_LOW] = s.current[SENSOR_HIGH] = NAN;
+      if (trace_len == size)
+      {
+         size = size ? size * 2 : 1024;
+         trace = realloc (trace, size * sizeof (Sample));
+      }
+      trace[trace_len++] = s;
+   }
+   fclose (f);
+   if (!trace_len)
+   {
+      fprintf (stderr, "%s: no samples\n", name);
+      exit (1);
+   }
+}
+
+
+/* Running the firmware */
+
+// set up eeprom as if the UI had been used to set the limits and the clock, then start up like main.c
+static void
+boot (int16_t open, int16_t close, int16_t run, int16_t deadband, int16_t predict)
+{
+   DT_t dt = { 1, 12, 15, 0, 0, 0 };
+   uint8_t i;
+
+   sim_eeprom_erase ();
+   for (i = SENSOR_LOW; i <= SENSOR_HIGH; i++)
+   {
+      gLimits[i][LIMIT_UP] = open;
+      gLimits[i][LIMIT_DN] = close;
+      gStall[i] = 600;
+      gTravel[i] = 0;
+   }
+   gMotorRun = run;
+   gDeadBand = deadband;
+   gPredict = predict;
+   gBacklight = 15;
+   save_eeprom_values ();
+   while (eeprom_pending ())
+   {
+      sim_ticks++;
+      run_eeprom ();
+   }
+   sim_ticks = 0;
+   eeprom_write_block ((const void *) &dt, (void *) &eeDateTime, sizeof (dt));
+   sim_eeprom_writes = 0;
+
+   load_eeprom_values ();
+   rtc_init ();
+   measure_init ();
+   window_init ();
+}
+
+static void
+usage (const char *name)
+{
+   fprintf (stderr, "usage: %s [options]\n"
+            "  -d days       length of a synthetic run (default 7)\n"
+            "  -t file       replay a recorded trace instead\n"
+            "  -o file       write a minute by minute log\n"
+            "  -u degrees    open limit (default 20.0)\n"
+            "  -l degrees    close limit (default 15.0)\n"
+            "  -r seconds    motor run time (default 60)\n"
+            "  -b degrees    dead-band (default 0.5)\n"
+            "  -p 0|1        predictive opening (default 1)\n"
+            "  -L seconds    lower vent travel time (default 45)\n"
+            "  -U seconds    upper vent travel time (default 30)\n"
+            "  -e            fit DS2413 end stop switches\n"
+            "  -s seed       noise seed\n", name);
+   exit (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+   double days = 7, open = 20.0, close = 15.0, deadband = 0.5;
+   int run = 60, predict = 1, opt;
+   const char *tracefile = NULL, *logfile = NULL;
+   FILE *log = NULL;
+   uint64_t step, steps;
+   double t = 0, wall;
+   uint16_t day;
+   uint32_t fw_starts[2] = { 0, 0 }, fw_stalls[2] = { 0, 0 }, fw_timeouts[2] = { 0, 0 }, fw_ampsecs[2] = { 0, 0 };
+   double started;
+   uint8_t i;
+
+   vent[SENSOR_LOW].travel = 45;
+   vent[SENSOR_HIGH].travel = 30;
+
+   while ((opt = getopt (argc, argv, "d:t:o:u:l:r:b:p:L:U:es:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'd':
+         days = atof (optarg);
+         break;
+      case 't':
+         tracefile = optarg;
+         break;
+      case 'o':
+         logfile = optarg;
+         break;
+      case 'u':
+         open = atof (optarg);
+         break;
+      case 'l':
+         close = atof (optarg);
+         break;
+      case 'r':
+         run = atoi (optarg);
+         break;
+      case 'b':
+         deadband = atof (optarg);
+         break;
+      case 'p':
+         predict = atoi (optarg);
+         break;
+      case 'L':
+         vent[SENSOR_LOW].travel = atof (optarg);
+         break;
+      case 'U':
+         vent[SENSOR_HIGH].travel = atof (optarg);
+         break;
+      case 'e':
+         sim_endstops = true;
+         break;
+      case 's':
+         seed = atoi (optarg);
+         break;
+      default:
+         usage (argv[0]);
+      }
+   }
+
+   if (tracefile)
+   {
+      load_trace (tracefile);
+      days = (trace[trace_len - 1].t - trace[0].t) / 86400.0;
+      replay (trace[0].t);
+   }
+   else
+   {
+      synthetic (0);
+      house = temp[SENSOR_OUT];
+   }
+
+   if (logfile && !(log = fopen (logfile, "w")))
+   {
+      perror (logfile);
+      return 1;
+   }
+   if (log)
+      fprintf (log, "# seconds,lower,upper,outside,battery,lower pos,upper pos,lower state,upper state,lower mA,upper mA\n");
+
+   boot (open * 100, close * 100, run, deadband * 100, predict);
+   day = today ();
+
+   steps = days * 86400.0 * 1000.0 / STEP_MS;
+   started = sim_cputime ();
+   for (step = 0; step < steps; step++)
+   {
+      // the system timer wraps like the real one, keep our own time for the model
+      sim_ticks += STEP_MS;
+      t = (step + 1) * STEP;
+
+      if (trace)
+         replay (trace[0].t + t);
+      else
+         synthetic (t);
+      move_vent (&vent[SENSOR_LOW], trace ? trace[trace_idx].current[SENSOR_LOW] : NAN);
+      move_vent (&vent[SENSOR_HIGH], trace ? trace[trace_idx].current[SENSOR_HIGH] : NAN);
+
+      // the firmware main loop
+      run_rtc ();
+      run_measure ();
+      run_windows ();
+      run_eeprom ();
+
+      read_motors ();
+
+      for (i = SENSOR_LOW; i <= SENSOR_HIGH; i++)
+      {
+         if (temp[i] * 100.0 > gLimits[i][LIMIT_UP])
+            vent[i].hot += STEP;
+         if (temp[i] * 100.0 < gLimits[i][LIMIT_DN])
+            vent[i].cold += STEP;
+      }
+
+      // the firmware starts its motor activity afresh each day
+      if (today () != day)
+      {
+         day = today ();
+         for (i = SENSOR_LOW; i <= SENSOR_HIGH; i++)
+         {
+            fw_starts[i] += gYesterday[i].starts;
+            fw_stalls[i] += gYesterday[i].stalls;
+            fw_timeouts[i] += gYesterday[i].timeouts;
+            fw_ampsecs[i] += gYesterday[i].ampsecs;
+         }
+      }
+
+      if (log && (((step + 1) % (60000 / STEP_MS)) == 0))
+         fprintf (log, "%.0f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,%d,%.0f,%.0f\n", t, temp[SENSOR_LOW], temp[SENSOR_HIGH],
+                  temp[SENSOR_OUT], battery, vent[SENSOR_LOW].pos, vent[SENSOR_HIGH].pos, gWinState[SENSOR_LOW],
+                  gWinState[SENSOR_HIGH], vent[SENSOR_LOW].current, vent[SENSOR_HIGH].current);
+   }
+   wall = sim_cputime () - started;
+   if (log)
+      fclose (log);
+
+   for (i = SENSOR_LOW; i <= SENSOR_HIGH; i++)
+   {
+      fw_starts[i] += gToday[i].starts;
+      fw_stalls[i] += gToday[i].stalls;
+      fw_timeouts[i] += gToday[i].timeouts;
+      fw_ampsecs[i] += gToday[i].ampsecs;
+   }
+
+   printf ("simulated %.1f days in %.2f seconds (%.0f x real time)\n", t / 86400.0, wall, wall > 0 ? t / wall : 0);
+   printf ("                          lower     upper\n");
+   printf ("motor starts          %9u %9u\n", vent[SENSOR_LOW].starts, vent[SENSOR_HIGH].starts);
+   printf ("  firmware count      %9u %9u\n", fw_starts[SENSOR_LOW], fw_starts[SENSOR_HIGH]);
+   printf ("  stalls              %9u %9u\n", fw_stalls[SENSOR_LOW], fw_stalls[SENSOR_HIGH]);
+   printf ("  timeouts            %9u %9u\n", fw_timeouts[SENSOR_LOW], fw_timeouts[SENSOR_HIGH]);
+   printf ("energy used (A.s)     %9.0f %9.0f\n", vent[SENSOR_LOW].ampsecs, vent[SENSOR_HIGH].ampsecs);
+   printf ("  firmware count      %9u %9u\n", fw_ampsecs[SENSOR_LOW], fw_ampsecs[SENSOR_HIGH]);
+   printf ("hours over open limit %9.1f %9.1f\n", vent[SENSOR_LOW].hot / 3600.0, vent[SENSOR_HIGH].hot / 3600.0);
+   printf ("hours under close     %9.1f %9.1f\n", vent[SENSOR_LOW].cold / 3600.0, vent[SENSOR_HIGH].cold / 3600.0);
+   printf ("learned travel (s)    %9d %9d\n", gTravel[SENSOR_LOW], gTravel[SENSOR_HIGH]);
+   printf ("eeprom bytes written  %9u\n", sim_eeprom_writes);
+   printf ("  most to one byte    %9u\n", sim_eeprom_wear ());
+   printf ("first control (ms)    %9d\n", gBootControl);
+
+   return 0;
+}
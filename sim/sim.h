@@ -0,0 +1,47 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  sim.h   -   Trace replay simulator - interface between the simulated hardware and the vent/house model
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <drv/timer.h>
+
+// simulated system clock in milliseconds
+extern ticks_t sim_ticks;
+// number of bytes written to eeprom
+extern uint32_t sim_eeprom_writes;
+// DS2413 end stop switches fitted to the vents
+extern bool sim_endstops;
+// ms from start to the vents first being under control
+extern int16_t gBootControl;
+
+void sim_eeprom_erase (void);
+uint32_t sim_eeprom_wear (void);
+// processor time used so far in seconds
+double sim_cputime (void);
+
+// supplied by the model for the simulated hardware
+int16_t sim_temperature (uint8_t sensor);       // hundredths of a degree
+uint16_t sim_analog (uint8_t chan);             // millivolts on an ADC pin
+uint8_t sim_switches (uint8_t vent);            // DS2413 PIO state
+
+#endif
@@ -0,0 +1,125 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  tracedump.c   -   Turns the binary event trace dumped by the controller into a timeline
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+#include "watchdog.h"
+
+
+// capture the serial port while sending the dump command, eg.
+//    stty -F /dev/ttyUSB0 115200 raw; cat /dev/ttyUSB0 > dump.bin & printf '!' > /dev/ttyUSB0
+// then './tracedump dump.bin'. Anything before the "TRC" header is skipped.
+
+static const char *tasks[] = { "boot", "clock", "measure", "windows", "radio", "display", "eeprom", "stack" };
+static const char *events[] = { "task", "ow start", "ow read", "adc", "window", "nrf tx", "nrf rx", "eeprom", "ow reject", "journal" };
+static const char *states[] = { "MANOPENING", "MANCLOSING", "MANOPEN", "MANCLOSED", "WINOPENING", "WINCLOSING", "WINOPEN", "WINCLOSED" };
+static const char *sensors[] = { "lower", "upper", "outside" };
+
+static const char *
+name (const char **names, size_t n, unsigned i)
+{
+   return i < n ? names[i] : "?";
+}
+#define NAME(a, i)   name (a, sizeof (a) / sizeof (a[0]), i)
+
+static void
+print_arg (const Trace_t * rec, uint8_t last_task)
+{
+   switch (rec->event)
+   {
+   case TR_TASK:
+      printf ("%s took %d ms", NAME (tasks, last_task), rec->arg);
+      break;
+   case TR_OW_START:
+      printf ("buses %02x", rec->arg);
+      break;
+   case TR_OW_READ:
+   case TR_OW_REJECT:
+      printf ("%s%d.%02d C", rec->arg < 0 ? "-" : "", abs (rec->arg) / 100, abs (rec->arg) % 100);
+      break;
+   case TR_ADC:
+      printf ("battery %d.%02d V", rec->arg / 100, rec->arg % 100);
+      break;
+   case TR_WINDOW:
+      printf ("%s vent %s", NAME (sensors, rec->arg >> 8), NAME (states, rec->arg & 0xff));
+      break;
+   case TR_NRF_TX:
+      printf ("%s", rec->arg == 1 ? "ok" : "failed");
+      break;
+   case TR_NRF_RX:
+      printf ("packet '%c'", rec->arg);
+      break;
+   case TR_EEPROM:
+      printf ("offset %d", rec->arg);
+      break;
+   case TR_JOURNAL:
+      printf ("slot %d offset %d", rec->arg >> 8, rec->arg & 0xff);
+      break;
+   default:
+      printf ("%d", rec->arg);
+   }
+}
+
+int
+main (int argc, char *argv[])
+{
+   FILE *in = stdin;
+   Trace_t rec;
+   int c, match = 0;
+   uint8_t count, i, last_task = TASK_BOOT;
+   uint16_t last = 0;
+   long t = 0;
+
+   if (argc > 1 && !(in = fopen (argv[1], "rb")))
+   {
+      perror (argv[1]);
+      return 1;
+   }
+
+   // find the header
+   while (match < 3 && (c = getc (in)) != EOF)
+      match = (c == "TRC"[match]) ? match + 1 : (c == 'T');
+   if (match < 3 || fread (&count, 1, 1, in) != 1)
+   {
+      fprintf (stderr, "no trace found\n");
+      return 1;
+   }
+
+   printf ("    time   delta  task      event     argument\n");
+   for (i = 0; i < count; i++)
+   {
+      if (fread (&rec, sizeof (rec), 1, in) != 1)
+      {
+         fprintf (stderr, "trace cut short after %d of %d records\n", i, count);
+         return 1;
+      }
+      // times are relative to the first record, the 16 bit tick count wraps every 65s
+      if (i)
+         t += (uint16_t) (rec.when - last);
+      printf ("%8ld %7u  %-8s  %-8s  ", t, i ? (uint16_t) (rec.when - last) : 0, NAME (tasks, rec.task), NAME (events, rec.event));
+      print_arg (&rec, last_task);
+      printf ("\n");
+      last = rec.when;
+      last_task = rec.task;
+   }
+
+   return 0;
+}
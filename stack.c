@@ -0,0 +1,132 @@
+/**
+ * \file
+ * <!--
+ * This file is part of Robin's Tunnel house window opener
+ *
+ * Bertos is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As a special exception, you may use this file as part of a free software
+ * library without restriction.  Specifically, if other files instantiate
+ * templates or use macros or inline functions from this file, or you compile
+ * this file and link it with other files to produce an executable, this
+ * file does not by itself cause the resulting executable to be covered by
+ * the GNU General Public License.  This exception does not however
+ * invalidate any other reasons why the executable file might be covered by
+ * the GNU General Public License.
+ *
+ * Copyright 2015 Robin Gilks (www.gilks.org)
+ *
+ * -->
+ *
+ * \author Robin Gilks (g8ecj@gilks.org)
+ *
+ * \brief Window opener with nrf24l01 RF remote linking
+ * Stack and heap usage, worked out a few bytes at a time from the main loop
+ */
+
+#include <stdint.h>
+
+#include <avr/io.h>
+
+#include "stack.h"
+
+
+// RAM between the end of .bss and the stack is painted at reset. The stack only ever
+// grows down into the paint so the lowest byte that has changed is the high water mark.
+// Rather than count the lot each time, run_stack looks at a few bytes per pass, sweeping
+// up from the top of the heap to the mark and starting again whenever it gets there.
+
+extern uint8_t _end;
+extern uint8_t __stack;
+extern char *__brkval;          // top of the malloc heap, NULL until something is allocated
+
+#define STACK_CANARY  0xc5
+#define STACK_STEP    8         // bytes looked at per pass of the main loop
+
+int16_t gStackUsed;             // most stack ever used (bytes)
+int16_t gHeapUsed;              // malloc heap in use (bytes)
+int16_t gMinFree;               // least free RAM there has ever been between heap and stack (bytes)
+
+static uint8_t *StackMark = &__stack;   // lowest byte the stack has reached
+static uint8_t *StackScan;              // next byte to look at
+
+void StackPaint (void) __attribute__ ((naked))
+   __attribute__ ((section (".init1")));
+
+void
+StackPaint (void)
+{
+   uint8_t *p = &_end;
+
+   while (p <= &__stack)
+   {
+      *p = STACK_CANARY;
+      p++;
+   }
+}
+
+
+static uint8_t *
+heap_top (void)
+{
+   if (__brkval)
+      return (uint8_t *) __brkval;
+   return &_end;
+}
+
+
+// count the painted bytes from the heap up that have never been touched, the slow way
+uint16_t
+StackCount (void)
+{
+   const uint8_t *p = heap_top ();
+   uint16_t c = 0;
+
+   while (*p == STACK_CANARY && p <= &__stack)
+   {
+      p++;
+      c++;
+   }
+
+   return c;
+}
+
+
+void
+run_stack (void)
+{
+   uint8_t *base = heap_top ();
+   uint8_t n;
+
+   if (StackScan < base)
+      StackScan = base;
+
+   for (n = 0; n < STACK_STEP && StackScan < StackMark; n++, StackScan++)
+   {
+      if (*StackScan != STACK_CANARY)
+      {
+         StackMark = StackScan;
+         break;
+      }
+   }
+
+   // got to the mark, go round again from the bottom
+   if (StackScan >= StackMark)
+      StackScan = base;
+
+   gStackUsed = &__stack - StackMark + 1;
+   gHeapUsed = base - &_end;
+   gMinFree = StackMark - base;
+}
@@ -0,0 +1,34 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  stack.h   -   Stack and heap high water marks, kept up to date from the main loop
+//
+//  History:   1.0 - First release. 
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _STACK_H
+#define _STACK_H
+
+#include <stdint.h>
+
+extern int16_t gStackUsed;
+extern int16_t gHeapUsed;
+extern int16_t gMinFree;
+
+uint16_t StackCount (void);
+void run_stack (void);
+
+#endif
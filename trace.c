@@ -0,0 +1,123 @@
+/**
+ * \file
+ * <!--
+ * This file is part of Robin's Tunnel house window opener
+ *
+ * Bertos is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As a special exception, you may use this file as part of a free software
+ * library without restriction.  Specifically, if other files instantiate
+ * templates or use macros or inline functions from this file, or you compile
+ * this file and link it with other files to produce an executable, this
+ * file does not by itself cause the resulting executable to be covered by
+ * the GNU General Public License.  This exception does not however
+ * invalidate any other reasons why the executable file might be covered by
+ * the GNU General Public License.
+ *
+ * Copyright 2015 Robin Gilks (www.gilks.org)
+ *
+ * -->
+ *
+ * \author Robin Gilks (g8ecj@gilks.org)
+ *
+ * \brief Window opener with nrf24l01 RF remote linking
+ * A ring of small fixed size trace records for chasing where the time goes in the main loop
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <drv/timer.h>
+
+#include "trace.h"
+#include "watchdog.h"
+
+#ifdef TRACE
+
+// Events go into the ring oldest first and overwrite as it wraps, so it always holds
+// the last TRACE_RECORDS of them. A task that runs for TRACE_SLOW or more freezes the
+// ring half a ring later, keeping what led up to the spike and a little after it,
+// until it has been dumped.
+
+#define TRACE_SLOW   20         // ms
+
+static Trace_t Ring[TRACE_RECORDS];
+static uint8_t Head;            // where the next record goes
+static uint8_t Count;           // how many records are in the ring
+static uint8_t Task;            // the task running now
+static uint16_t TaskStart;      // and when it started
+static int8_t Stop = -1;        // records to go before freezing, -1 if not triggered
+
+
+void
+trace (uint8_t event, int16_t arg)
+{
+   Trace_t *rec;
+
+   if (Stop == 0)
+      return;
+   if (Stop > 0)
+      Stop--;
+
+   rec = &Ring[Head];
+   rec->event = event;
+   rec->task = Task;
+   rec->when = timer_clock ();
+   rec->arg = arg;
+
+   if (++Head >= TRACE_RECORDS)
+      Head = 0;
+   if (Count < TRACE_RECORDS)
+      Count++;
+}
+
+
+// a new task starting is also the end of the last one, note how long it took
+// (init is always slow so doesn't count)
+void
+trace_task (uint8_t task)
+{
+   uint16_t now = timer_clock ();
+   uint16_t took = ticks_to_ms ((uint16_t) (now - TaskStart));
+
+   if (took >= TRACE_SLOW && Task != TASK_BOOT && Stop < 0)
+      Stop = TRACE_RECORDS / 2;
+   Task = task;
+   TaskStart = now;
+   trace (TR_TASK, took);
+}
+
+
+// send the ring out in binary, header then the records oldest first, and start afresh
+void
+trace_dump (KFile * fd)
+{
+   uint8_t i, n;
+
+   kfile_write (fd, "TRC", 3);
+   kfile_write (fd, &Count, sizeof (Count));
+   n = (Head + TRACE_RECORDS - Count) % TRACE_RECORDS;
+   for (i = 0; i < Count; i++)
+   {
+      kfile_write (fd, &Ring[n], sizeof (Trace_t));
+      if (++n >= TRACE_RECORDS)
+         n = 0;
+   }
+   Count = 0;
+   Stop = -1;
+}
+
+#endif
@@ -0,0 +1,69 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  trace.h   -   Binary event trace ring, dumped on the serial port and decoded with sim/tracedump
+//
+//  History:   1.0 - First release. 
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+#include <io/kfile.h>
+
+// only built with TRACE defined, 'make TRACE=1'
+#define TRACE_RECORDS 32
+// serial command that dumps the ring
+#define TRACE_DUMP    '!'
+
+// what happened, the argument depends on the event
+enum TRACE_EVENT
+{
+   TR_TASK,                     // task started, ms the last one took
+   TR_OW_START,                 // 1-wire conversions started, PORTD bits of the buses
+   TR_OW_READ,                  // 1-wire temperature read, value
+   TR_ADC,                      // analog channels scanned, battery volts
+   TR_WINDOW,                   // vent state change, sensor << 8 | new state
+   TR_NRF_TX,                   // radio sent, 1 if all went
+   TR_NRF_RX,                   // radio received, packet type
+   TR_EEPROM,                   // setting byte written, offset
+   TR_OW_REJECT,                // 1-wire temperature read thrown out, value
+   TR_JOURNAL,                  // journal byte written, slot << 8 | offset
+   TR_EVENTS
+};
+
+// 6 bytes, the same layout on the AVR and the host decoder
+typedef struct
+{
+   uint8_t event;
+   uint8_t task;                // TASK_xxx from watchdog.h
+   uint16_t when;               // low 16 bits of the tick count
+   int16_t arg;
+} Trace_t;
+
+#ifdef TRACE
+void trace (uint8_t event, int16_t arg);
+void trace_task (uint8_t task);
+void trace_dump (KFile * fd);
+#else
+// without the ring (192 bytes of RAM) the calls come to nothing
+static inline void trace (uint8_t event, int16_t arg) { (void) event; (void) arg; }
+static inline void trace_task (uint8_t task) { (void) task; }
+#endif
+
+#endif
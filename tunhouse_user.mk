@@ -16,11 +16,17 @@ tunhouse_USER_CSRC = \
 	$(tunhouse_SRC_PATH)/nrf.c \
 	$(tunhouse_SRC_PATH)/minmax.c \
 	$(tunhouse_SRC_PATH)/rtc.c \
+	$(tunhouse_SRC_PATH)/ds3231.c \
 	$(tunhouse_SRC_PATH)/eeprommap.c \
 	$(tunhouse_SRC_PATH)/measure.c \
+	$(tunhouse_SRC_PATH)/owbus.c \
 	$(tunhouse_SRC_PATH)/analog.c \
 	$(tunhouse_SRC_PATH)/window.c \
 	$(tunhouse_SRC_PATH)/ui.c \
+	$(tunhouse_SRC_PATH)/stack.c \
+	$(tunhouse_SRC_PATH)/watchdog.c \
+	$(tunhouse_SRC_PATH)/trace.c \
+	$(tunhouse_SRC_PATH)/bench.c \
 	#
 
 # Files included by the user.
@@ -53,3 +59,27 @@ tunhouse_USER_CPPFLAGS = \
 	-fwrapv \
 	-DVERSION=\"$(GIT_VERSION)\" \
 	#
+
+# 'make ramreport' lists the .data and .bss taken by each of our own modules,
+# whatever is left of the 2k is heap and stack (the free RAM figure printed at boot)
+ramreport: all
+	@$(tunhouse_PREFIX)size $(patsubst %.c,obj/tunhouse/%.o,$(tunhouse_USER_CSRC))
+	@$(tunhouse_PREFIX)size --format=avr --mcu=$(tunhouse_MCU) images/tunhouse.elf
+
+# 'make TRACE=1' builds in the event trace ring (trace.c) that '!' on the serial port dumps for
+# sim/tracedump. It takes 192 bytes of RAM so is left out otherwise. Run 'make clean' when switching.
+ifdef TRACE
+tunhouse_USER_CPPFLAGS += -DTRACE
+endif
+
+# 'make bench' rebuilds with the benchmarks run in place of the main loop (bench.c) and runs them
+# under simavr, the cycle count and stack use of each hot function go to bench.csv.
+# Run 'make clean' before building the real firmware again.
+ifdef BENCH
+tunhouse_USER_CPPFLAGS += -DBENCH
+endif
+
+bench:
+	$(MAKE) clean
+	$(MAKE) BENCH=1 all
+	simavr -m $(tunhouse_MCU) -f 16000000 images/tunhouse.elf | grep -a 'BENCH,' | sed 's/.*BENCH,//' > bench.csv
@@ -23,6 +23,7 @@
 
 
 #include <cfg/debug.h>
+#include <cfg/macros.h>
 
 #include <cpu/irq.h>
 #include <cpu/power.h>
@@ -31,6 +32,7 @@
 #include <avr/pgmspace.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <algo/crc8.h>
 
@@ -48,11 +50,14 @@
 #include "eeprommap.h"
 #include "window.h"
 #include "ui.h"
+#include "stack.h"
+#include "watchdog.h"
+#include "trace.h"
+#include "bench.h"
 
 
-// a table of fields that are flashing
-#define MAXFLASH    10
-static int8_t flashing[MAXFLASH];
+// a bit for each field that is flashing
+static uint8_t flashing[(eNUMVARS + 7) / 8];
 
 // mode values
 #define MONITOR     0
@@ -79,9 +84,16 @@ ticks_t backlight_timer = 0;
 extern Serial serial;
 static Term term;
 
-static const char lcd_degree[8] = { 0x1c, 0x14, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00 };   /* degree - char set B doesn't have it!! */
+static const char lcd_degree[8] PROGMEM = { 0x1c, 0x14, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00 };   /* degree - char set B doesn't have it!! */
+static const char lcd_rising[8] PROGMEM = { 0x04, 0x0e, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00 };   /* up arrow */
+static const char lcd_falling[8] PROGMEM = { 0x04, 0x04, 0x04, 0x04, 0x15, 0x0e, 0x04, 0x00 };  /* down arrow */
 
 #define DEGREE 1
+#define RISING 2
+#define FALLING 3
+
+// a trend smaller than this (hundredths of a degree an hour) shows as steady
+#define TREND_STEADY 20
 
 // prototype functions that may not be used
 int8_t get_line (int8_t field, int8_t screen);
@@ -175,7 +187,12 @@ enum STYLE
    eSHORT,
    eBOOLEAN,
    eTRILEAN,
-   eWINDOW
+   eWINDOW,
+   eSWITCH,
+   eCOUNT,
+   eRESET,
+   eTASK,
+   eTREND
 };
 
 
@@ -223,6 +240,40 @@ const Vars variables[eNUMVARS] PROGMEM = {
    {&gWinAuto[SENSOR_HIGH],               0,     0,     0,     eTRILEAN,  null_inc},     //manual/auto
    {&gWinState[SENSOR_LOW],               0,     0,     0,      eWINDOW,  null_inc},     //open/close etc
    {&gWinState[SENSOR_HIGH],              0,     0,     0,      eWINDOW,  null_inc},     //open/close etc
+   {&gEndStop[SENSOR_LOW],                0,     0,     0,      eSWITCH,  null_inc},     //end stop switches
+   {&gEndStop[SENSOR_HIGH],               0,     0,     0,      eSWITCH,  null_inc},     //end stop switches
+
+   {&gToday[SENSOR_LOW].starts,           0,     0,     0,       eCOUNT,  null_inc},     // motor activity today
+   {&gToday[SENSOR_LOW].stalls,           0,     0,     0,       eCOUNT,  null_inc},
+   {&gToday[SENSOR_LOW].timeouts,         0,     0,     0,       eCOUNT,  null_inc},
+   {&gToday[SENSOR_LOW].ampsecs,          0,     0,     0,       eCOUNT,  null_inc},
+   {&gToday[SENSOR_HIGH].starts,          0,     0,     0,       eCOUNT,  null_inc},
+   {&gToday[SENSOR_HIGH].stalls,          0,     0,     0,       eCOUNT,  null_inc},
+   {&gToday[SENSOR_HIGH].timeouts,        0,     0,     0,       eCOUNT,  null_inc},
+   {&gToday[SENSOR_HIGH].ampsecs,         0,     0,     0,       eCOUNT,  null_inc},
+   {&gYesterday[SENSOR_LOW].ampsecs,      0,     0,     0,       eCOUNT,  null_inc},     // charge used yesterday
+   {&gYesterday[SENSOR_HIGH].ampsecs,     0,     0,     0,       eCOUNT,  null_inc},
+
+   {&gDeadBand,                           0,   500,    50,       eSHORT,  deca_inc},     // minimum gap between open and close
+   {&gPredict,                            0,     1,     1,     eBOOLEAN,   int_inc},     // open early on a rising temperature
+
+   {&gStackUsed,                          0,     0,     0,       eCOUNT,  null_inc},     // most stack used since reset
+   {&gHeapUsed,                           0,     0,     0,       eCOUNT,  null_inc},     // heap in use
+   {&gMinFree,                            0,     0,     0,       eCOUNT,  null_inc},     // least free RAM since reset
+
+   {&gResetCause,                         0,     0,     0,       eRESET,  null_inc},     // why we last reset
+   {&gResetTask,                          0,     0,     0,        eTASK,  null_inc},     // task the watchdog caught
+   {&gResetCount,                         0,     0,     0,       eCOUNT,  null_inc},     // watchdog resets since power up
+
+   {&gBootScreen,                         0,     0,     0,       eCOUNT,  null_inc},     // ms to the first screen
+   {&gBootControl,                        0,     0,     0,       eCOUNT,  null_inc},     // ms to the vents under control
+
+   {&gCrcRetry,                           0,     0,     0,       eCOUNT,  null_inc},     // sensor reads that failed the CRC
+   {&gRejected,                           0,     0,     0,       eCOUNT,  null_inc},     // sensor readings thrown out
+
+   {&gTrend[SENSOR_LOW],                  0,     0,     0,       eTREND,  null_inc},     // temperature trend per hour
+   {&gTrend[SENSOR_HIGH],                 0,     0,     0,       eTREND,  null_inc},
+   {&gTrend[SENSOR_OUT],                  0,     0,     0,       eTREND,  null_inc},
 };
 
 
@@ -260,6 +311,27 @@ const char openstr[]  PROGMEM  = "Open ";
 const char timestr[]  PROGMEM  = "Time";
 const char uppstr[]   PROGMEM  = "Upper";
 const char voltstr[]  PROGMEM  = "Volts";
+const char motorstr[] PROGMEM  = "Run Stl T/O  A.s";
+const char ydaystr[]  PROGMEM  = "Yday A.s";
+const char ventstr[]  PROGMEM  = "Vent Control";
+const char deadstr[]  PROGMEM  = "Dead band";
+const char predstr[]  PROGMEM  = "Predict";
+const char memstr[]   PROGMEM  = "Memory";
+const char stackstr[] PROGMEM  = "Stack peak";
+const char heapstr[]  PROGMEM  = "Heap";
+const char freestr[]  PROGMEM  = "Least free";
+const char bytestr[]  PROGMEM  = "bytes";
+const char resetstr[] PROGMEM  = "Last reset";
+const char causestr[] PROGMEM  = "Cause";
+const char taskstr[]  PROGMEM  = "Task";
+const char countstr[] PROGMEM  = "Watchdog";
+const char bootstr[]  PROGMEM  = "Boot time";
+const char shownstr[] PROGMEM  = "Display";
+const char ctrlstr[]  PROGMEM  = "Control";
+const char msstr[]    PROGMEM  = "ms";
+const char readstr[]  PROGMEM  = "Sensor errors";
+const char crcstr[]   PROGMEM  = "CRC retry";
+const char rejstr[]   PROGMEM  = "Rejected";
 const char degreestr[] PROGMEM = { DEGREE, 'C', 0 };
 
 
@@ -293,8 +365,10 @@ const Screen lower[] PROGMEM = {
    {-1,         1,   13,  degreestr,    0,    0},
    {eDN_NOW,    2,    0,     nowstr,    6,    5},
    {-1,         2,   13,  degreestr,    0,    0},
+   {eDN_TREND,  2,    0,     nulstr,   15,    5},
    {eDN_MAX,    3,    0,     maxstr,    6,    5},
    {-1,         3,   13,  degreestr,    0,    0},
+   {eENDSTOP_LO, 3,   0,     nulstr,   15,    5},
    {-2,         0,    0,     nulstr,    0,    0}
 };
 
@@ -305,8 +379,10 @@ const Screen upper[] PROGMEM = {
    {-1,         1,   13,  degreestr,    0,    0},
    {eUP_NOW,    2,    0,     nowstr,    6,    5},
    {-1,         2,   13,  degreestr,    0,    0},
+   {eUP_TREND,  2,    0,     nulstr,   15,    5},
    {eUP_MAX,    3,    0,     maxstr,    6,    5},
    {-1,         3,   13,  degreestr,    0,    0},
+   {eENDSTOP_HI, 3,   0,     nulstr,   15,    5},
    {-2,         0,    0,     nulstr,    0,    0}
 };
 
@@ -316,6 +392,7 @@ const Screen external[] PROGMEM = {
    {-1,         1,   13,  degreestr,    0,    0},
    {eOT_NOW,    2,    0,     nowstr,    6,    5},
    {-1,         2,   13,  degreestr,    0,    0},
+   {eOT_TREND,  2,    0,     nulstr,   15,    5},
    {eOT_MAX,    3,    0,     maxstr,    6,    5},
    {-1,         3,   13,  degreestr,    0,    0},
    {-2,         0,    0,     nulstr,    0,    0}
@@ -339,6 +416,56 @@ const Screen battery[] PROGMEM = {
    {-2,         0,    0,     nulstr,    0,    0}
 };
 
+const Screen motors[] PROGMEM = {
+   {-1,         0,    4,   motorstr,    0,    0},
+   {eSTARTS_LO, 1,    0,      lostr,    4,    3},
+   {eSTALLS_LO, 1,    0,     nulstr,    8,    3},
+   {eTIMEOUTS_LO,1,   0,     nulstr,   12,    3},
+   {eAMPSECS_LO,1,    0,     nulstr,   16,    4},
+   {eSTARTS_HI, 2,    0,      upstr,    4,    3},
+   {eSTALLS_HI, 2,    0,     nulstr,    8,    3},
+   {eTIMEOUTS_HI,2,   0,     nulstr,   12,    3},
+   {eAMPSECS_HI,2,    0,     nulstr,   16,    4},
+   {eAMPSECS_LO_DAY,3,0,    ydaystr,    9,    5},
+   {eAMPSECS_HI_DAY,3,0,     nulstr,   15,    5},
+   {-2,         0,    0,     nulstr,    0,    0}
+};
+
+const Screen memory[] PROGMEM = {
+   {-1,         0,    2,     memstr,    0,    0},
+   {eSTACKUSED, 1,    0,   stackstr,   11,    4},
+   {-1,         1,   16,    bytestr,    0,    0},
+   {eHEAPUSED,  2,    0,    heapstr,   11,    4},
+   {-1,         2,   16,    bytestr,    0,    0},
+   {eMINFREE,   3,    0,    freestr,   11,    4},
+   {-1,         3,   16,    bytestr,    0,    0},
+   {-2,         0,    0,     nulstr,    0,    0}
+};
+
+const Screen resets[] PROGMEM = {
+   {-1,         0,    2,   resetstr,    0,    0},
+   {eRESETCAUSE,1,    0,   causestr,   10,    8},
+   {eRESETTASK, 2,    0,    taskstr,   10,    8},
+   {eRESETCOUNT,3,    0,   countstr,   10,    5},
+   {-2,         0,    0,     nulstr,    0,    0}
+};
+
+const Screen boot[] PROGMEM = {
+   {-1,         0,    2,    bootstr,    0,    0},
+   {eBOOTSCREEN,1,    0,   shownstr,   10,    5},
+   {-1,         1,   16,      msstr,    0,    0},
+   {eBOOTCONTROL,2,   0,    ctrlstr,   10,    5},
+   {-1,         2,   16,      msstr,    0,    0},
+   {-2,         0,    0,     nulstr,    0,    0}
+};
+
+const Screen errors[] PROGMEM = {
+   {-1,         0,    2,    readstr,    0,    0},
+   {eCRCRETRY,  1,    0,     crcstr,   10,    5},
+   {eREJECTED,  2,    0,     rejstr,   10,    5},
+   {-2,         0,    0,     nulstr,    0,    0}
+};
+
 const Screen Set_Lower[] PROGMEM = {
    {-1,         0,    1,     lowstr,    0,    0},
    {-1,         0,   10,     limstr,    0,    0},
@@ -389,9 +516,17 @@ const Screen Set_Battery[] PROGMEM = {
    {-2,         0,    0,     nulstr,     0,    0}
 };
 
+const Screen Set_Control[] PROGMEM = {
+   {-1,         0,    1,    ventstr,    0,    0},
+   {eDEADBAND,  1,    1,    deadstr,   13,    5},
+   {-1,         1,   17,  degreestr,    0,    0},
+   {ePREDICT,   2,    1,    predstr,   13,    4},
+   {-2,         0,    0,     nulstr,    0,    0}
+};
+
 
-#define NUM_INFO    6
-#define NUM_SETUP   4
+#define NUM_INFO    11
+#define NUM_SETUP   5
 
 #define FIRSTINFO   0
 #define MAXINFO     (NUM_INFO - 1)
@@ -401,43 +536,158 @@ const Screen Set_Battery[] PROGMEM = {
 
 
 // order here is critical - screen numbers are used to derive sensor numbers in some modes!!
-static const Screen *screen_list[] =  { summary, lower, upper, external, datetime, battery, Set_Lower, Set_Upper, Set_Time, Set_Battery };
+static const Screen * const screen_list[] PROGMEM =  { summary, lower, upper, external, datetime, battery, motors, memory, resets, boot, errors, Set_Lower, Set_Upper, Set_Time, Set_Battery, Set_Control };
 
+static const Screen *
+get_screen (int8_t screen)
+{
+   return (const Screen *) pgm_read_word (&screen_list[screen]);
+}
 
-// add field to list of flashing fields
-void
-set_flash (int8_t field, int8_t set)
+// index of the screen being shown, worked out once when it changes so finding a field is a lookup
+#define NO_ENTRY    0xff
+static int8_t index_screen = -1;
+static uint8_t entry[eNUMVARS];         // which line of the screen table each field is on
+static int8_t field_min, field_max;     // first and last fields on the screen
+
+static void
+index_fields (int8_t screen)
 {
-   int8_t i;
+   int8_t i, field;
+   const Screen *scrn = get_screen (screen);
 
-   for (i = 0; i < MAXFLASH; i++)
+   if (screen == index_screen)
+      return;
+   index_screen = screen;
+
+   memset (entry, NO_ENTRY, sizeof (entry));
+   field_min = 99;
+   field_max = -1;
+   for (i = 0; (field = (int8_t) pgm_read_byte (&scrn[i].field)) != -2; i++)
    {
-      if (set)
-      {
-         // find a free slot or already set then set it
-         if ((flashing[i] == 0) || (flashing[i] == field))
-         {
-            flashing[i] = field;
-            break;
-         }
-      }
-      else
-      {
-         // find which slot its in and clear it
-         if (flashing[i] == field)
-         {
-            flashing[i] = 0;
-            break;
-         }
-      }
+      if (field < 0)
+         continue;
+      entry[field] = i;
+      if (field > field_max)
+         field_max = field;
+      if (field < field_min)
+         field_min = field;
    }
 }
 
+
+// texts for the boolean, trilean, window and end stop switch states
+static const char tritext[4][8] PROGMEM = { "off ", "on  ", " auto ", "manual" };
+static const char wintext[4][8] PROGMEM = { "OPENING", "CLOSING", "OPEN   ", "CLOSED " };
+static const char switchtext[4][6] PROGMEM = { " mid ", "open ", "shut ", "fault" };
+
+// texts for the reset cause and the task the watchdog caught
+static const char resettext[4][9] PROGMEM = { "power   ", "external", "brownout", "watchdog" };
+static const char tasktext[8][9] PROGMEM = { "none    ", "clock   ", "measure ", "windows ", "radio   ", "display ", "eeprom  ", "stack   " };
+
+// small formatters for the UI, every field drawn would otherwise go through the full printf parser
+
+static void
+put_char (char c)
+{
+   kfile_putc (c, &term.fd);
+}
+
+// move the cursor
+static void
+put_pos (uint8_t row, uint8_t col)
+{
+   put_char (TERM_CPC);
+   put_char (TERM_ROW + row);
+   put_char (TERM_COL + col);
+}
+
+// text from flash
+static void
+put_str_P (PGM_P s)
+{
+   char c;
+
+   while ((c = pgm_read_byte (s++)))
+      put_char (c);
+}
+
+static void
+put_spaces (uint8_t n)
+{
+   while (n--)
+      put_char (' ');
+}
+
+// unsigned decimal with leading zeros to make it at least 'digits' long
+// returns the number of characters
+static uint8_t
+put_uint (uint16_t value, uint8_t digits)
+{
+   char buf[5];
+   uint8_t n = 0, len;
+
+   do
+   {
+      buf[n++] = '0' + value % 10;
+      value /= 10;
+   }
+   while (value);
+   while (n < digits)
+      buf[n++] = '0';
+
+   len = n;
+   while (n)
+      put_char (buf[--n]);
+   return len;
+}
+
+// signed decimal, returns the number of characters
+static uint8_t
+put_int (int16_t value)
+{
+   if (value < 0)
+   {
+      put_char ('-');
+      return put_uint (0U - (uint16_t) value, 1) + 1;
+   }
+   return put_uint (value, 1);
+}
+
+// hundredths as a decimal with 1 or 2 places, the sign done separately so -0.5 keeps it
+static void
+put_fixed (int16_t value, uint8_t places)
+{
+   uint16_t whole = value;
+
+   if (value < 0)
+   {
+      put_char ('-');
+      whole = 0U - (uint16_t) value;
+   }
+   put_uint (whole / 100, 1);
+   put_char ('.');
+   if (places == 1)
+      put_uint (whole % 100 / 10, 1);
+   else
+      put_uint (whole % 100, 2);
+}
+
+
+// add field to list of flashing fields
+void
+set_flash (int8_t field, int8_t set)
+{
+   if (set)
+      flashing[field >> 3] |= BV (field & 7);
+   else
+      flashing[field >> 3] &= ~BV (field & 7);
+}
+
 // return an indicator on whether this field is flashing and should currently be blanked (true) or displayed (false)
 static int8_t
 check_flash (int8_t field)
 {
-   int8_t i;
    static int8_t flash_state = true;
    static ticks_t flash_on_timer, flash_off_timer;
 
@@ -460,11 +710,8 @@ check_flash (int8_t field)
       }
    }
 
-   for (i = 0; i < MAXFLASH; i++)
-   {
-      if (flashing[i] == field)
-         return flash_state;
-   }
+   if (flashing[field >> 3] & BV (field & 7))
+      return flash_state;
    return false;
 }
 
@@ -472,66 +719,86 @@ check_flash (int8_t field)
 static void
 print_field (int16_t value, int8_t field, uint8_t screen)
 {
-   int8_t i;
-   int16_t whole, part;
-   char spaces[10] = "         ";
-   char tritext[4][8] = { "off ", "on  ", " auto ", "manual" };
-   char wintext[4][8] = { "OPENING", "CLOSING", "OPEN   ", "CLOSED " };
+   uint8_t i, width, len;
+
+   const Screen *scrn = get_screen (screen);
 
-   const Screen *scrn = screen_list[screen];
+   index_fields (screen);
+   i = entry[field];
+   if (i == NO_ENTRY)
+      return;
 
-   for (i = 0; (int8_t) pgm_read_byte (&scrn[i].field) != -2; i++)
+   // set write position
+   put_pos (pgm_read_byte (&scrn[i].row), pgm_read_byte (&scrn[i].vcol));
+   // if its currently in a blank phase of the flashing then we're done (leave as spaces)
+   if (check_flash (field))
    {
-      if ((int8_t) pgm_read_byte (&scrn[i].field) == field)     // found the correct one
-      {
-         // set write position
-         kfile_printf (&term.fd, "%c%c%c", TERM_CPC, TERM_ROW + pgm_read_byte (&scrn[i].row),
-                       TERM_COL + pgm_read_byte (&scrn[i].vcol));
-         // if its currently in a blank phase of the flashing then we're done (leave as spaces)
-         if (check_flash (field))
-         {
-            // output spaces of field width to clear it in case flashing or changing
-            kfile_printf (&term.fd, "%.*s", pgm_read_byte (&scrn[i].width), spaces);
-            break;
-         }
-         // output value based on type of field
-         switch (pgm_read_byte(&variables[field].style))
-         {
-         case eNORMAL:
-            kfile_printf (&term.fd, "%d", value);
-            break;
-         case eDATE:
-            kfile_printf (&term.fd, "%02d", value);
-            break;
-         case eLARGE:
-            kfile_printf (&term.fd, "%u", (uint16_t) value);
-            break;
-         case eDECIMAL:
-            // split the value into those bits before and after the decimal point
-            // if the whole part is less than 1 then we loose the sign bit so do it manually in all cases
-            whole = abs (value / 100);
-            part = abs (value % 100);
-            kfile_printf (&term.fd, "%.*s%d.%02u", value < 0 ? 1 : 0, "-", whole, part);
-            break;
-         case eSHORT:
-            // split the value into those bits before and after the decimal point, ONLY 1 PLACE!
-            // if the whole part is less than 1 then we loose the sign bit so do it manually in all cases
-            whole = abs (value / 100);
-            part = abs (value % 100) / 10;
-            kfile_printf (&term.fd, "%.*s%d.%1u", value < 0 ? 1 : 0, "-", whole, part);
-            break;
-         case eBOOLEAN:
-            kfile_printf (&term.fd, "%s", tritext[value & 1]);
-            break;
-         case eTRILEAN:
-            kfile_printf (&term.fd, "%s", tritext[value & 3]);
-            break;
-         case eWINDOW:
-            kfile_printf (&term.fd, "%s", wintext[value & 3]);
-            break;
-         }
-         break;
-      }
+      // output spaces of field width to clear it in case flashing or changing
+      put_spaces (pgm_read_byte (&scrn[i].width));
+      return;
+   }
+   // output value based on type of field
+   switch (pgm_read_byte(&variables[field].style))
+   {
+   case eNORMAL:
+      put_int (value);
+      break;
+   case eDATE:
+      put_uint (value, 2);
+      break;
+   case eLARGE:
+      put_uint ((uint16_t) value, 1);
+      break;
+   case eDECIMAL:
+      put_fixed (value, 2);
+      break;
+   case eSHORT:
+      // ONLY 1 PLACE!
+      put_fixed (value, 1);
+      break;
+   case eBOOLEAN:
+      put_str_P (tritext[value & 1]);
+      break;
+   case eTRILEAN:
+      put_str_P (tritext[value & 3]);
+      break;
+   case eWINDOW:
+      put_str_P (wintext[value & 3]);
+      break;
+   case eCOUNT:
+      // pad to the field width as counters go back to zero each day
+      width = pgm_read_byte (&scrn[i].width);
+      len = put_int (value);
+      if (len < width)
+         put_spaces (width - len);
+      break;
+   case eSWITCH:
+      // nothing to show if no end stop switches fitted
+      if (value >= 0)
+         put_str_P (switchtext[value & 3]);
+      break;
+   case eRESET:
+      put_str_P (resettext[value & 3]);
+      break;
+   case eTASK:
+      put_str_P (tasktext[value & 7]);
+      break;
+   case eTREND:
+      // an arrow for which way then how many degrees an hour, padded as it varies in length
+      width = pgm_read_byte (&scrn[i].width);
+      if (value >= TREND_STEADY)
+         put_char (RISING);
+      else if (value <= -TREND_STEADY)
+         put_char (FALLING);
+      else
+         put_char ('=');
+      if (value < 0)
+         value = -value;
+      put_fixed (value, 1);
+      len = value >= 1000 ? 5 : 4;
+      if (len < width)
+         put_spaces (width - len);
+      break;
    }
 }
 
@@ -545,24 +812,13 @@ print_field (int16_t value, int8_t field, uint8_t screen)
 static int8_t
 find_next_field (int8_t field, int8_t screen, int8_t dirn)
 {
-   int8_t i, min = 99, max = -1;
-   const Screen *scrn = screen_list[screen];
-
-   for (i = 0; (int8_t) pgm_read_byte (&scrn[i].field) != -2; i++)
-   {
-      if ((int8_t) pgm_read_byte (&scrn[i].field) < 0)
-         continue;
-      if ((int8_t) pgm_read_byte (&scrn[i].field) > max)
-         max = pgm_read_byte (&scrn[i].field);
-      if ((int8_t) pgm_read_byte (&scrn[i].field) < min)
-         min = pgm_read_byte (&scrn[i].field);
-   }
+   index_fields (screen);
 
    field += dirn;
-   if (field > max)
-      field = min;
-   if (field < min)
-      field = max;
+   if (field > field_max)
+      field = field_min;
+   if (field < field_min)
+      field = field_max;
 
    return field;
 }
@@ -571,19 +827,12 @@ find_next_field (int8_t field, int8_t screen, int8_t dirn)
 int8_t
 get_line (int8_t field, int8_t screen)
 {
-   const Screen *scrn = screen_list[screen];
-   int8_t i;
+   const Screen *scrn = get_screen (screen);
 
    // get the line this field is on
-   for (i = 0; (int8_t) pgm_read_byte (&scrn[i].field) != -2; i++)
-   {
-      if ((int8_t) pgm_read_byte (&scrn[i].field) < 0)
-         continue;
-      if ((int8_t) pgm_read_byte (&scrn[i].field) == field)
-      {
-         return (int8_t) pgm_read_byte (&scrn[i].row);
-      }
-   }
+   index_fields (screen);
+   if ((field >= 0) && (field < eNUMVARS) && (entry[field] != NO_ENTRY))
+      return (int8_t) pgm_read_byte (&scrn[entry[field]].row);
    // if field not found then return something odd!!
    return -1;
 }
@@ -619,18 +868,17 @@ print_screen (int8_t screen)
 {
    int8_t i = 0, j;
    PGM_P text;
-   const Screen *scrn = screen_list[screen];
+   const Screen *scrn = get_screen (screen);
    int16_t *pVar;
 
    while ((int8_t) pgm_read_byte (&scrn[i].field) != -2)
    {
-      kfile_printf (&term.fd, "%c%c%c", TERM_CPC, TERM_ROW + pgm_read_byte (&scrn[i].row),
-                    TERM_COL + pgm_read_byte (&scrn[i].col));
+      put_pos (pgm_read_byte (&scrn[i].row), pgm_read_byte (&scrn[i].col));
       text = (PGM_P) pgm_read_word (&scrn[i].text);
 
       for (j = 0; (const char) (pgm_read_byte (&text[j])) && j < 20; j++)
       {
-         kfile_putc ((const char) pgm_read_byte (&text[j]), &term.fd);
+         put_char ((const char) pgm_read_byte (&text[j]));
       }
 
       if ((int8_t) pgm_read_byte (&scrn[i].field) != -1)
@@ -669,10 +917,16 @@ flag_warnings (void)
 void
 ui_init (void)
 {
+   char degree[8];
 
    lcd_init ();
    lcd_display (1, 0, 0);
-   lcd_remapChar (lcd_degree, DEGREE);  // put the degree symbol on character 0x01
+   memcpy_P (degree, lcd_degree, sizeof (degree));
+   lcd_remapChar (degree, DEGREE);      // put the degree symbol on character 0x01
+   memcpy_P (degree, lcd_rising, sizeof (degree));
+   lcd_remapChar (degree, RISING);      // and the trend arrows on 0x02 and 0x03
+   memcpy_P (degree, lcd_falling, sizeof (degree));
+   lcd_remapChar (degree, FALLING);
 
    term_init (&term);
    // pass serial descriptor to terminal emulator
@@ -696,14 +950,38 @@ ui_load_defaults(void)
 
    for (field = 1; field < eNUMVARS; field++)
    {
+      // leave display only values (sensor readings, window and switch states) alone
+      if (pgm_read_word(&variables[field].min) == pgm_read_word(&variables[field].max))
+         continue;
       pVar = (int16_t *) pgm_read_word(&variables[field].value);
       *pVar = pgm_read_word(&variables[field].defval);
    }
+   set_epoch_time ();
    save_eeprom_values ();
 
 }
 
 
+// put a setting back to its default if it wasn't saved (missing) or has been corrupted (out of range)
+// only those that can be set from the UI have limits and defaults, anything else is left alone
+void
+ui_check_value(int16_t * var, bool missing)
+{
+   uint8_t field;
+
+   for (field = 1; field < eNUMVARS; field++)
+   {
+      if ((int16_t *) pgm_read_word(&variables[field].value) != var ||
+          pgm_read_word(&variables[field].min) == pgm_read_word(&variables[field].max))
+         continue;
+      if (missing || *var < (int16_t) pgm_read_word(&variables[field].min) ||
+          *var > (int16_t) pgm_read_word(&variables[field].max))
+         *var = pgm_read_word(&variables[field].defval);
+      return;
+   }
+}
+
+
 // get a row of text from the terminal emulator, indicating which row it is.
 // If we have all the data, return -1. On the next read we will restart at the beginning.
 int8_t
@@ -776,12 +1054,16 @@ run_ui (uint8_t remote_key)
    static int16_t saved_value;
    uint8_t sensor;
    int16_t *pVar;
-   int16_t inc;
+   int16_t inc, edited;
    IncFunc_t pIncFunc;
 
    // mark those fields that should ne flashed
    flag_warnings ();
 
+   // bring the date and time fields up to date unless one of them is being edited
+   if ((mode != FIELDEDIT) || (field < eHOUR) || (field > eYEAR))
+      update_datetime ();
+
    keymask_t key;
    key = kbd_peek ();
 
@@ -791,6 +1073,14 @@ run_ui (uint8_t remote_key)
       key = kfile_getc (&serial.fd);
       if ((int16_t) key == EOF)
          key = 0;
+#ifdef TRACE
+      // dump the event trace for sim/tracedump to decode
+      else if (key == TRACE_DUMP)
+      {
+         trace_dump (&serial.fd);
+         key = 0;
+      }
+#endif
       // if alpha key (PC connected remote) then handle pseudo-long press (upper case)
       // We still just use the bit pattern of the lowest 3 bits. Candidate keys are a, b, d or i, j, l or q, r, t
       if ((key > 0x40) && (key < 0x60))
@@ -848,9 +1138,9 @@ run_ui (uint8_t remote_key)
       pIncFunc = (PGM_VOID_P) pgm_read_word(&variables[field].get_inc);
 
       // refresh the value to place the cursor on the screen in the right place
-      kfile_printf (&term.fd, "%c", TERM_BLINK_ON);
+      put_char (TERM_BLINK_ON);
       print_field (*pVar, field, screen_number);
-      kfile_printf (&term.fd, "%c", TERM_BLINK_OFF);
+      put_char (TERM_BLINK_OFF);
 
       switch (key)
       {
@@ -860,20 +1150,26 @@ run_ui (uint8_t remote_key)
          switch (field)
          {
          case eADJUSTTIME:
+            // save adjustment in eeprom, the clock itself has to be taken as it is now
+            update_datetime ();
+            set_epoch_time ();
+            break;
          case eHOUR:
          case eMINUTE:
          case eSECOND:
          case eDAY:
          case eMONTH:
          case eYEAR:
-         case eBATCAL:
-         case eSTALL_DN:
-         case eSTALL_UP:
-            // set Unix time in seconds, save adjustment in eeprom
+            // the other fields were held still for the edit, bring them up to date so the
+            // time spent editing isn't lost, then set Unix time in seconds from them
+            edited = *pVar;
+            update_datetime ();
+            *pVar = edited;
             set_epoch_time ();
             break;
          }
-         save_eeprom_values ();
+         // written out in the background by run_eeprom
+         save_eeprom_value (pVar);
 
          mode = PAGEEDIT;
          set_flash (field, false);
@@ -913,11 +1209,11 @@ run_ui (uint8_t remote_key)
    case PAGEEDIT:
       // refresh the value to place the cursor on the screen in the right place
       pVar = (int16_t *) pgm_read_word(&variables[field].value);
-      kfile_printf (&term.fd, "%c", TERM_CURS_ON);
-      kfile_printf (&term.fd, "%c", TERM_BLINK_ON);
+      put_char (TERM_CURS_ON);
+      put_char (TERM_BLINK_ON);
       print_field (*pVar, field, screen_number);
-      kfile_printf (&term.fd, "%c", TERM_BLINK_OFF);
-      kfile_printf (&term.fd, "%c", TERM_CURS_OFF);
+      put_char (TERM_BLINK_OFF);
+      put_char (TERM_CURS_OFF);
       switch (key)
       {
       case K_CENTRE:
@@ -1012,8 +1308,56 @@ run_ui (uint8_t remote_key)
    // refresh with clear screen first if screen number changes
    if (screen_number != last_screen)
    {
-      kfile_printf (&term.fd, "%c", TERM_CLR);
+      put_char (TERM_CLR);
       print_screen (screen_number);
       last_screen = screen_number;
+      boot_mark (&gBootScreen);
    }
 }
+
+
+#ifdef BENCH
+// the screen a field is on, indexed so print_field goes straight to it
+static int8_t
+bench_screen (int8_t field)
+{
+   int8_t screen;
+
+   for (screen = FIRSTINFO; screen <= MAXSETUP; screen++)
+   {
+      index_fields (screen);
+      if (entry[field] != NO_ENTRY)
+         return screen;
+   }
+   return FIRSTINFO;
+}
+
+#define BENCH_FIELD(name, field)                                                       \
+   do                                                                                  \
+   {                                                                                   \
+      int8_t s = bench_screen (field);                                                 \
+      int16_t v = *(int16_t *) pgm_read_word (&variables[field].value);                \
+      BENCH_RUN (name, print_field (v, field, s));                                     \
+   } while (0)
+
+// drawing a field of each style (nothing uses eLARGE), indexing a screen and drawing a whole one
+void
+ui_bench (void)
+{
+   BENCH_FIELD ("print_field eNORMAL", eADJUSTTIME);
+   BENCH_FIELD ("print_field eDATE", eHOUR);
+   BENCH_FIELD ("print_field eDECIMAL", eBATTERY);
+   BENCH_FIELD ("print_field eSHORT", eDN_NOW);
+   BENCH_FIELD ("print_field eBOOLEAN", eRADIO);
+   BENCH_FIELD ("print_field eTRILEAN", eWINAUTO_LO);
+   BENCH_FIELD ("print_field eWINDOW", eWINSTATE_LO);
+   BENCH_FIELD ("print_field eSWITCH", eENDSTOP_LO);
+   BENCH_FIELD ("print_field eCOUNT", eAMPSECS_LO);
+   BENCH_FIELD ("print_field eRESET", eRESETCAUSE);
+   BENCH_FIELD ("print_field eTASK", eRESETTASK);
+
+   index_screen = -1;
+   BENCH_RUN ("index_fields", index_fields (FIRSTINFO));
+   BENCH_RUN ("print_screen", print_screen (FIRSTINFO));
+}
+#endif
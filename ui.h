@@ -68,6 +68,41 @@ enum VARS
    eWINSTATE_LO,
    eWINSTATE_HI,
 
+   eENDSTOP_LO,
+   eENDSTOP_HI,
+
+   eSTARTS_LO,
+   eSTALLS_LO,
+   eTIMEOUTS_LO,
+   eAMPSECS_LO,
+   eSTARTS_HI,
+   eSTALLS_HI,
+   eTIMEOUTS_HI,
+   eAMPSECS_HI,
+   eAMPSECS_LO_DAY,
+   eAMPSECS_HI_DAY,
+
+   eDEADBAND,
+   ePREDICT,
+
+   eSTACKUSED,
+   eHEAPUSED,
+   eMINFREE,
+
+   eRESETCAUSE,
+   eRESETTASK,
+   eRESETCOUNT,
+
+   eBOOTSCREEN,
+   eBOOTCONTROL,
+
+   eCRCRETRY,
+   eREJECTED,
+
+   eDN_TREND,
+   eUP_TREND,
+   eOT_TREND,
+
    eNUMVARS
 };
 
@@ -76,6 +111,7 @@ extern int16_t gRadio;
 
 void ui_init (void);
 void ui_load_defaults(void);
+void ui_check_value(int16_t * var, bool missing);
 void run_ui (uint8_t remote_key);
 void set_flash (int8_t field, int8_t set);
 int8_t ui_termrowget(uint8_t * buffer);
@@ -0,0 +1,210 @@
+/**
+ * \file
+ * <!--
+ * This file is part of Robin's Tunnel house window opener
+ *
+ * Bertos is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As a special exception, you may use this file as part of a free software
+ * library without restriction.  Specifically, if other files instantiate
+ * templates or use macros or inline functions from this file, or you compile
+ * this file and link it with other files to produce an executable, this
+ * file does not by itself cause the resulting executable to be covered by
+ * the GNU General Public License.  This exception does not however
+ * invalidate any other reasons why the executable file might be covered by
+ * the GNU General Public License.
+ *
+ * Copyright 2015 Robin Gilks (www.gilks.org)
+ *
+ * -->
+ *
+ * \author Robin Gilks (g8ecj@gilks.org)
+ *
+ * \brief Window opener with nrf24l01 RF remote linking
+ * Watchdog on the main loop and a trail of breadcrumbs that survives the reset
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cfg/macros.h>
+#include <avr/io.h>
+#include <avr/wdt.h>
+
+#include <drv/timer.h>
+
+#include "watchdog.h"
+#include "trace.h"
+
+
+// Each task leaves a crumb (its number and the tick count) as it starts. The trail is in
+// .noinit RAM so it is still there after the watchdog bites and the newest crumb says
+// which task never finished. The trail is copied out at boot before it gets overwritten.
+
+#define CRUMB_MAGIC  0x4352
+#define CRUMB_TRAIL  8
+
+typedef struct
+{
+   uint8_t task;
+   uint16_t when;               // low 16 bits of the tick count when it started
+} Crumb_t;
+
+typedef struct
+{
+   uint16_t magic;
+   uint8_t head;                // trail[head] is the task running now
+   uint16_t resets;             // watchdog resets since power up
+   Crumb_t trail[CRUMB_TRAIL];
+} Crumbs_t;
+
+static Crumbs_t Crumbs __attribute__ ((section (".noinit")));
+static uint8_t ResetFlags __attribute__ ((section (".noinit")));
+
+int16_t gResetCause;            // why we last reset, RESET_xxx
+int16_t gResetTask;             // task running when the watchdog bit
+int16_t gResetCount;            // watchdog resets since power up
+int16_t gBootScreen;            // ms from reset to the first screen drawn
+int16_t gBootControl;           // and to the vents being under control
+
+// the trail as it was at reset, oldest first, times in ms before the last crumb
+static Crumb_t Wedged[CRUMB_TRAIL];
+
+
+// The watchdog stays armed at its shortest timeout after it fires so it has to be stopped
+// before the C runtime gets going. Pick up why we reset while we are at it.
+void wdog_early (void) __attribute__ ((naked))
+   __attribute__ ((section (".init3")));
+
+void
+wdog_early (void)
+{
+   ResetFlags = MCUSR;
+   MCUSR = 0;
+   wdt_disable ();
+}
+
+
+void
+wdog_init (void)
+{
+   uint8_t i, n;
+   Crumb_t *last;
+
+   if (ResetFlags & BV (WDRF))
+      gResetCause = RESET_WATCHDOG;
+   else if (ResetFlags & BV (BORF))
+      gResetCause = RESET_BROWNOUT;
+   else if (ResetFlags & BV (EXTRF))
+      gResetCause = RESET_EXTERNAL;
+   else
+      gResetCause = RESET_POWER;
+
+   // nothing worth keeping in RAM that has just powered up
+   if (Crumbs.magic != CRUMB_MAGIC || (ResetFlags & BV (PORF)))
+   {
+      memset (&Crumbs, 0, sizeof (Crumbs));
+      Crumbs.magic = CRUMB_MAGIC;
+   }
+
+   if (gResetCause == RESET_WATCHDOG)
+   {
+      Crumbs.resets++;
+      last = &Crumbs.trail[Crumbs.head];
+      gResetTask = last->task;
+      for (i = 0; i < CRUMB_TRAIL; i++)
+      {
+         n = (Crumbs.head + 1 + i) % CRUMB_TRAIL;
+         Wedged[i].task = Crumbs.trail[n].task;
+         Wedged[i].when = ticks_to_ms ((uint16_t) (last->when - Crumbs.trail[n].when));
+      }
+   }
+   else
+      gResetTask = TASK_BOOT;
+   gResetCount = Crumbs.resets;
+
+   crumb (TASK_BOOT);
+}
+
+
+// arm once everything is up, the main loop has to come round inside this
+void
+wdog_arm (void)
+{
+   wdt_enable (WDOG_TIMEOUT);
+}
+
+
+void
+crumb (uint8_t task)
+{
+   Crumbs.head = (Crumbs.head + 1) % CRUMB_TRAIL;
+   Crumbs.trail[Crumbs.head].task = task;
+   Crumbs.trail[Crumbs.head].when = timer_clock ();
+   trace_task (task);
+}
+
+
+// note how long after reset something first happened
+void
+boot_mark (int16_t * mark)
+{
+   if (*mark)
+      return;
+   *mark = ticks_to_ms (timer_clock ());
+   if (*mark == 0)
+      *mark = 1;
+}
+
+
+// what went on before the last reset, for the radio. Cause, task, reset count then as much of
+// the end of the trail as fits in size bytes, as task and ms pairs. Returns the bytes used
+uint8_t
+wdog_report (uint8_t * buffer, uint8_t size)
+{
+   uint8_t i, fit, n = 0;
+
+   if (size < 2 + sizeof (Crumbs.resets))
+      return 0;
+   buffer[n++] = gResetCause;
+   buffer[n++] = gResetTask;
+   memcpy (&buffer[n], &Crumbs.resets, sizeof (Crumbs.resets));
+   n += sizeof (Crumbs.resets);
+   // the crumbs nearest the reset matter most, leave out the oldest if they don't all fit
+   fit = (size - n) / (1 + sizeof (Wedged[0].when));
+   for (i = fit < CRUMB_TRAIL ? CRUMB_TRAIL - fit : 0; i < CRUMB_TRAIL; i++)
+   {
+      buffer[n++] = Wedged[i].task;
+      memcpy (&buffer[n], &Wedged[i].when, sizeof (Wedged[i].when));
+      n += sizeof (Wedged[i].when);
+   }
+   return n;
+}
+
+
+// the same on the serial port at boot
+void
+wdog_dump (KFile * fd)
+{
+   uint8_t i;
+
+   kfile_printf (fd, "Reset cause %d count %d\r\n", gResetCause, gResetCount);
+   if (gResetCause != RESET_WATCHDOG)
+      return;
+   kfile_printf (fd, "Stuck in task %d, before that", gResetTask);
+   for (i = 0; i < CRUMB_TRAIL; i++)
+      kfile_printf (fd, " %d@-%u", Wedged[i].task, Wedged[i].when);
+   kfile_printf (fd, "\r\n");
+}
@@ -0,0 +1,67 @@
+//---------------------------------------------------------------------------
+// Copyright (C) 2015 Robin Gilks
+//
+//
+//  watchdog.h   -   Watchdog on the main loop with breadcrumbs that say what it was doing when it bit
+//
+//  History:   1.0 - First release. 
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _WATCHDOG_H
+#define _WATCHDOG_H
+
+#include <stdint.h>
+
+#include <io/kfile.h>
+
+// the main loop has to come round inside this or the watchdog resets us
+#define WDOG_TIMEOUT  WDTO_2S
+
+// why we last reset
+enum RESET
+{
+   RESET_POWER,
+   RESET_EXTERNAL,
+   RESET_BROWNOUT,
+   RESET_WATCHDOG
+};
+
+// the tasks that leave crumbs, in main loop order
+enum TASK
+{
+   TASK_BOOT,
+   TASK_RTC,
+   TASK_MEASURE,
+   TASK_WINDOWS,
+   TASK_NRF,
+   TASK_UI,
+   TASK_EEPROM,
+   TASK_STACK
+};
+
+extern int16_t gResetCause;
+extern int16_t gResetTask;
+extern int16_t gResetCount;
+extern int16_t gBootScreen;
+extern int16_t gBootControl;
+
+void wdog_init (void);
+void wdog_arm (void);
+void crumb (uint8_t task);
+uint8_t wdog_report (uint8_t * buffer, uint8_t size);
+void wdog_dump (KFile * fd);
+void boot_mark (int16_t * mark);
+
+#endif
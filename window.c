@@ -36,6 +36,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include <avr/pgmspace.h>
 
@@ -45,7 +46,11 @@
 
 #include "measure.h"
 #include "rtc.h"
+#include "eeprommap.h"
 #include "window.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "bench.h"
 
 // state of the windows on the 2 sensors
 int16_t gWinState[2];
@@ -55,12 +60,31 @@ int16_t gWinAuto[2];
 int16_t gMotorRun;
 // open/close timer rather than wait for a contact closure
 uint32_t gWinTimer[2];
+// learned travel time of each vent, 0 until the first end of travel is seen
+int16_t gTravel[2];
+// minimum gap between open and close temperatures
+int16_t gDeadBand;
+// open early if the temperature will be over the limit by the time the vent has opened
+int16_t gPredict;
+// motor activity so far today and over the whole of yesterday
+MS_t gToday[2];
+MS_t gYesterday[2];
+// the day the motor activity is being collected for
+static uint16_t StatsDay;
+
+// per run state used to spot the end of travel in the motor current
+static bool Running[2];
+static bool Learned[2];
+static uint32_t RunStart[2];
+static int16_t RunBase[2];
 
 static void do_motorup (uint8_t sensor);
 static void do_motordn (uint8_t sensor);
 static void do_motoroff (uint8_t sensor);
 static void do_motorcan (uint8_t sensor);
 static void winmachine (uint8_t sensor, uint8_t event);
+static void start_run (uint8_t sensor);
+static void end_run (uint8_t sensor);
 
 
 /*
@@ -71,10 +95,10 @@ PD7 D7    FET driver          } LO motor DOWN
 PB0 D8    FET driver          } HI motor DOWN
 */
 
-#define LO_UP(x)      { if (x) PORTD |= BV(2); else PORTD &=~BV(2); } while(0)
-#define HI_UP(x)      { if (x) PORTD |= BV(3); else PORTD &=~BV(3); } while(0)
-#define LO_DN(x)      { if (x) PORTD |= BV(7); else PORTD &=~BV(7); } while(0)
-#define HI_DN(x)      { if (x) PORTB |= BV(0); else PORTB &=~BV(0); } while(0)
+#define LO_UP(x)      do { if (x) PORTD |= BV(2); else PORTD &=~BV(2); } while(0)
+#define HI_UP(x)      do { if (x) PORTD |= BV(3); else PORTD &=~BV(3); } while(0)
+#define LO_DN(x)      do { if (x) PORTD |= BV(7); else PORTD &=~BV(7); } while(0)
+#define HI_DN(x)      do { if (x) PORTB |= BV(0); else PORTB &=~BV(0); } while(0)
 
 typedef struct PROGMEM
 {
@@ -103,10 +127,29 @@ const WINDOW_NEXTSTATE window_nextstate[][6] PROGMEM = {
 void
 window_init (void)
 {
+   int16_t *count;
+
    gWinState[SENSOR_LOW] = WINCLOSED;
    gWinState[SENSOR_HIGH] = WINCLOSED;
    gWinTimer[SENSOR_LOW] = 0;
    gWinTimer[SENSOR_HIGH] = 0;
+   // erased eeprom reads as -1, treat as not yet learned
+   if (gTravel[SENSOR_LOW] < 0)
+      gTravel[SENSOR_LOW] = 0;
+   if (gTravel[SENSOR_HIGH] < 0)
+      gTravel[SENSOR_HIGH] = 0;
+   StatsDay = today ();
+   // carry on with today's motor activity from the last journal checkpoint if it was today
+   if (gJournal.epoch && day_number (gJournal.epoch) == StatsDay)
+      memcpy (&gToday, &gJournal.today, sizeof (gToday));
+   // yesterday's counts read as -1 from erased eeprom until the first midnight saves them
+   for (count = (int16_t *) &gYesterday[0]; count < (int16_t *) &gYesterday[2]; count++)
+      if (*count < 0)
+         *count = 0;
+   // new settings read from an older eeprom layout
+   if ((gDeadBand < 0) || (gDeadBand > 500))
+      gDeadBand = DEADBANDVALUE;
+   gPredict &= 1;
    DDRD |= BV (2) | BV (3) | BV (7);
    DDRB |= BV (0);
    LO_UP (0);
@@ -140,7 +183,7 @@ windowcan (int8_t sensor)
 uint8_t
 windowidle(uint8_t sensor)
 {
-   if (sensor == SENSOR_OUT)
+   if (sensor >= SENSOR_OUT)
       return true;
 
    if ((gWinState[sensor] == MANOPENING) || (gWinState[sensor] == MANCLOSING))
@@ -150,6 +193,16 @@ windowidle(uint8_t sensor)
 }
 
 
+// find out if a window motor is running
+uint8_t
+windowmoving (uint8_t sensor)
+{
+   if (sensor >= SENSOR_OUT)
+      return false;
+
+   return Running[sensor];
+}
+
 
 // drive round the state machine, moving between states and initiating actions
 static void
@@ -165,6 +218,8 @@ winmachine (uint8_t sensor, uint8_t event)
     {
         pStateFunc (sensor);
     }
+    if (nextstate != state)
+       trace (TR_WINDOW, (sensor << 8) | nextstate);
     gWinState[sensor] = nextstate;
 }
 
@@ -174,7 +229,7 @@ do_motorup (uint8_t sensor)
 {
 
    // start timer if motor started
-   gWinTimer[sensor] = uptime () + gMotorRun;
+   start_run (sensor);
 
    // set direction relay for upwards motion (port A)
    // turn on power to this motor   (port B)
@@ -195,7 +250,7 @@ static void
 do_motordn (uint8_t sensor)
 {
    // start timer if motor started
-   gWinTimer[sensor] = uptime () + gMotorRun;
+   start_run (sensor);
    // direction relay defaults to down so ensure its off (port A)
    // turn on power to this motor (port B)
    if (sensor == SENSOR_LOW)
@@ -214,6 +269,7 @@ do_motordn (uint8_t sensor)
 static void
 do_motoroff (uint8_t sensor)
 {
+   end_run (sensor);
    // start lockout timer if motor stopped
    gWinTimer[sensor] = uptime () + LOCKOUTVALUE;
    // make sure both relays are de-energized
@@ -235,6 +291,8 @@ do_motoroff (uint8_t sensor)
 static void
 do_motorcan (uint8_t sensor)
 {
+   // a cancelled run tells us nothing about the travel time
+   Running[sensor] = false;
    // set timer so we have no more movements for LOCKOUT seconds
    gWinTimer[sensor] = uptime () + LOCKOUTVALUE;
    // make sure both relays are de-energized
@@ -252,12 +310,157 @@ do_motorcan (uint8_t sensor)
    }
 }
 
+// how long to run a motor - the learned travel time plus a margin, or the configured run time until learned
+static int16_t
+run_time (uint8_t sensor)
+{
+   if ((gTravel[sensor] > 0) && (gTravel[sensor] + MARGINVALUE < gMotorRun))
+      return gTravel[sensor] + MARGINVALUE;
+   return gMotorRun;
+}
+
+// keep a new travel time, only touching the eeprom if it has changed
+static void
+save_travel (uint8_t sensor, int16_t travel)
+{
+   if (travel > gMotorRun)
+      travel = gMotorRun;
+   if (travel == gTravel[sensor])
+      return;
+   gTravel[sensor] = travel;
+   save_eeprom_value (&gTravel[sensor]);
+}
+
+// note the start of a motor run and set the timer that will cut it off
+static void
+start_run (uint8_t sensor)
+{
+   gToday[sensor].starts++;
+   Running[sensor] = true;
+   Learned[sensor] = false;
+   RunStart[sensor] = uptime ();
+   RunBase[sensor] = 0;
+   gWinTimer[sensor] = RunStart[sensor] + run_time (sensor);
+}
+
+// motor stopped by timer or stall
+static void
+end_run (uint8_t sensor)
+{
+   // ran to the cut off without seeing the end of travel so allow longer next time
+   if (Running[sensor] && !Learned[sensor] && (gTravel[sensor] > 0)
+       && ((int32_t) (uptime () - RunStart[sensor]) >= run_time (sensor)))
+      save_travel (sensor, gTravel[sensor] + MARGINVALUE);
+   Running[sensor] = false;
+}
+
+// end of travel seen, learn how long it took
+static void
+travel_seen (uint8_t sensor)
+{
+   int16_t elapsed, travel;
+
+   if (Learned[sensor])
+      return;
+   Learned[sensor] = true;
+
+   elapsed = uptime () - RunStart[sensor];
+   // smooth out run to run variation once we have a value
+   travel = gTravel[sensor] > 0 ? (gTravel[sensor] * 3 + elapsed) / 4 : elapsed;
+   save_travel (sensor, travel);
+}
+
+// watch the motor current for the end of travel
+// closing, the vent comes up against its stop and the current rises
+// opening, the cable goes slack and the current drops away
+static void
+learn_travel (uint8_t sensor)
+{
+   int16_t elapsed;
+
+   if (!Running[sensor] || Learned[sensor])
+      return;
+
+   elapsed = uptime () - RunStart[sensor];
+   if (elapsed < INRUSHVALUE)
+      return;
+
+   // take the running current once the inrush has gone
+   if (RunBase[sensor] == 0)
+   {
+      RunBase[sensor] = gCurrent[sensor];
+      // too little current to see anything useful (no motor fitted?)
+      if (RunBase[sensor] < 100)
+         Learned[sensor] = true;
+      return;
+   }
+
+   if ((gCurrent[sensor] > RunBase[sensor] + RunBase[sensor] / 2) || (gCurrent[sensor] < RunBase[sensor] / 2))
+      travel_seen (sensor);
+}
+
+// see if the end stop switch in the direction of travel has been made
+static bool
+at_endstop (uint8_t sensor)
+{
+   if (!Running[sensor] || (gEndStop[sensor] == ENDSTOP_NONE))
+      return false;
+
+   if ((gWinState[sensor] == MANOPENING) || (gWinState[sensor] == WINOPENING))
+      return gEndStop[sensor] & ENDSTOP_OPEN;
+   else
+      return gEndStop[sensor] & ENDSTOP_CLOSED;
+}
+
+// at the start of a new day keep the last day's motor activity in eeprom and start again
+static void
+roll_stats (void)
+{
+   uint8_t sensor;
+
+   if (today () == StatsDay)
+      return;
+   StatsDay = today ();
+
+   for (sensor = SENSOR_LOW; sensor <= SENSOR_HIGH; sensor++)
+   {
+      gYesterday[sensor] = gToday[sensor];
+      gToday[sensor].starts = 0;
+      gToday[sensor].stalls = 0;
+      gToday[sensor].timeouts = 0;
+      gToday[sensor].ampsecs = 0;
+   }
+   save_eeprom_value (&gYesterday);
+}
+
+// see if the temperature will be over the open limit by the time the vent has finished opening
+static bool
+predict_open (uint8_t sensor, int16_t now, int16_t up)
+{
+   int32_t projected;
+
+   if (!gPredict || (gTrend[sensor] <= 0))
+      return false;
+
+   projected = now + (int32_t) gTrend[sensor] * run_time (sensor) / 3600;
+   return projected >= up;
+}
+
 // called from main on a regular basis to run state machine
 void
 run_windows (void)
 {
    uint8_t sensor;
    int16_t now, up, down;
+   bool ready;
+
+   roll_stats ();
+
+   // no temperature control until the first readings are in, the motor timers and end stops
+   // are still looked after so a manual move stops as it should
+   ready = measure_ready ();
+   if (ready)
+      boot_mark (&gBootControl);
 
    // for each sensor
    for (sensor = SENSOR_LOW; sensor <= SENSOR_HIGH; sensor++)
@@ -267,15 +470,35 @@ run_windows (void)
       else
          gWinAuto[sensor] = 3;
 
-      getlims (sensor, &now, &up, &down);
-      if (now >= up)
-         winmachine (sensor, TEMPGREATER);
-      else if (now <= down)
-         winmachine (sensor, TEMPLESSER);
+      // a sensor that has never given a good reading leaves its vent where it is
+      if (ready && measure_valid (sensor))
+      {
+         getlims (sensor, &now, &up, &down);
+         // keep the close point a dead-band below the open point so noise around the limits can't chatter the vent
+         if (down > up - gDeadBand)
+            down = up - gDeadBand;
+         // only look ahead from above the close point, otherwise a steep rise opens a vent the next pass closes
+         if ((now >= up) || ((now > down) && predict_open (sensor, now, up)))
+            winmachine (sensor, TEMPGREATER);
+         else if (now <= down)
+            winmachine (sensor, TEMPLESSER);
+      }
+
+      learn_travel (sensor);
+
+      // limit switch made - stop the motor now rather than wait for the timer
+      if (at_endstop (sensor))
+      {
+         travel_seen (sensor);
+         gWinTimer[sensor] = 0;
+         winmachine (sensor, TIMEOUT);
+      }
 
       // treat exceeding stall current as timeout - stop motor!
-      if (gCurrent[sensor] > (gStall[sensor] * 10))
+      // only while it runs, a stopped motor's current is taken unsmoothed and a spike would end a manual lockout
+      if (Running[sensor] && (gCurrent[sensor] > (gStall[sensor] * 10)))
       {
+         gToday[sensor].stalls++;
          gWinTimer[sensor] = 0;
          winmachine (sensor, TIMEOUT);
       }
@@ -283,8 +506,26 @@ run_windows (void)
       if ((gWinTimer[sensor]) && (uptime () > gWinTimer[sensor]))
       {
          // timers handled here so its all done from the main line, not from an interrupt callback
+         // the learned cut off is the normal end of a run, it is only a timeout if the end of travel wasn't seen
+         if (Running[sensor] && !Learned[sensor])
+            gToday[sensor].timeouts++;
          gWinTimer[sensor] = 0;
          winmachine (sensor, TIMEOUT);
       }
    }
 }
+
+
+#ifdef BENCH
+// round the state machine of the lower vent, open and closed again, then a whole pass
+void
+window_bench (void)
+{
+   gWinState[SENSOR_LOW] = WINCLOSED;
+   BENCH_RUN ("winmachine open", winmachine (SENSOR_LOW, TEMPGREATER));
+   BENCH_RUN ("winmachine opened", winmachine (SENSOR_LOW, TIMEOUT));
+   BENCH_RUN ("winmachine close", winmachine (SENSOR_LOW, TEMPLESSER));
+   BENCH_RUN ("winmachine closed", winmachine (SENSOR_LOW, TIMEOUT));
+   BENCH_RUN ("run_windows", run_windows ());
+}
+#endif
@@ -1,3 +1,5 @@
+#ifndef _WINDOW_H
+#define _WINDOW_H
 
 
 //states
@@ -26,12 +28,32 @@
 #define LOCKOUTVALUE 1800
 // how long before we cancel (determines how long the msg stays on the display)
 #define CANCELVALUE 3
+// let the motor inrush current and the shunt filter settle before taking a running current baseline
+#define INRUSHVALUE 5
+// margin added to the learned travel time before the motor is cut off
+#define MARGINVALUE 5
+// default gap between the open and close points if they are set too close together
+#define DEADBANDVALUE 50
 
 
+// motor activity of a vent over a day
+typedef struct motorstats
+{
+   int16_t starts;              // motor runs started
+   int16_t stalls;              // runs stopped by the stall current
+   int16_t timeouts;            // runs stopped by the run timer
+   int16_t ampsecs;             // charge used in amp-seconds
+} MS_t;
+
 
 extern int16_t gWinState[2];
 extern int16_t gWinAuto[2];
 extern int16_t gMotorRun;
+extern int16_t gTravel[2];
+extern int16_t gDeadBand;
+extern int16_t gPredict;
+extern MS_t gToday[2];
+extern MS_t gYesterday[2];
 
 void window_init (void);
 void run_windows (void);
@@ -41,4 +63,6 @@ void windowopen (int8_t sensor);
 void windowclose (int8_t sensor);
 void windowcan (int8_t sensor);
 uint8_t windowidle (uint8_t sensor);
+uint8_t windowmoving (uint8_t sensor);
 
+#endif